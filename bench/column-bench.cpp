@@ -0,0 +1,126 @@
+/*
+
+Compressed columns (luple-column.h) against plain vectors of rows
+
+Description:
+
+  A million trade rows: sorted timestamps, a symbol out of 64 strings, a quantity in
+  [0, 1000), a side that changes every few hundred rows and a price. Prints the encodings
+  and the compression ratio of every column, then the time of a range filter, an equality
+  filter on the symbol and a sum over one column, on the column_store and on the
+  std::vector of rows.
+
+Usage:
+
+  g++ -std=c++17 -O2 -I.. column-bench.cpp -o column-bench && ./column-bench [rows]
+
+*/
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "nuple.h"
+#include "luple-column.h"
+
+
+enum class side : char { buy, sell };
+
+using trade_t = nuple< $("ts"), std::int64_t, $("sym"), std::string, $("qty"), int, $("side"), side, $("px"), double >;
+
+
+template<typename F>
+double run ( F && f ) {
+
+  auto start = std::chrono::steady_clock::now();
+
+  std::size_t n = f();
+
+  std::chrono::duration< double, std::milli > time = std::chrono::steady_clock::now() - start;
+
+  if( n == 42 ) std::puts( "" );
+
+  return time.count();
+}
+
+void print ( char const * name, column_stats s ) {
+
+  std::printf( "%-5s %7.2fx %9zu -> %8zu bytes  for %3zu delta %3zu rle %3zu raw %3zu  dictionary %zu\n", name, s.ratio(), s.raw_bytes, s.bytes,
+               s.blocks[ luple_ns::column_for ], s.blocks[ luple_ns::column_delta ], s.blocks[ luple_ns::column_rle ], s.blocks[ luple_ns::column_raw ], s.dictionary );
+}
+
+
+int main ( int argc, char ** argv ) {
+
+  std::size_t n = argc > 1 ? std::atoll( argv[1] ) : 1000000;
+
+  std::mt19937 rng{ 1 };
+  std::vector< std::string > symbols;
+
+  for( int i = 0; i < 64; ++i ) symbols.push_back( "SYMBOL-" + std::to_string( i * 7919 ) );
+
+  std::vector< trade_t > rows;
+  std::int64_t ts = 1700000000000000;
+  side s = side::buy;
+
+  rows.reserve( n );
+
+  for( std::size_t i = 0; i < n; ++i ) {
+
+    ts += 1 + rng() % 100;
+
+    if( rng() % 500 == 0 ) s = s == side::buy ? side::sell : side::buy;
+
+    rows.push_back( trade_t{ ts, symbols[ rng() % 64 ], int( rng() % 1000 ), s, 100 + ( rng() % 10000 ) / 100. } );
+  }
+
+  column_store< trade_t > store;
+
+  std::printf( "build %.1f ms\n\n", run( [&]() { store = column_store< trade_t >{ rows }; return store.size(); } ) );
+
+  print( "ts", store.stats< $("ts") >() );
+  print( "sym", store.stats< $("sym") >() );
+  print( "qty", store.stats< $("qty") >() );
+  print( "side", store.stats< $("side") >() );
+  print( "px", store.stats< $("px") >() );
+
+  std::int64_t t0 = get< $("ts") >( rows[ n / 4 ] ), t1 = get< $("ts") >( rows[ n / 2 ] );
+  std::string const & sym = symbols[ 5 ];
+
+  std::printf( "\n%-28s %10s %10s\n", "", "columns", "rows" );
+
+  std::printf( "%-28s %7.2f ms %7.2f ms\n", "filter qty in [100, 199]",
+    run( [&]() { return store.filter< $("qty") >( 100, 199 ).size(); } ),
+    run( [&]() {
+      std::vector< std::uint32_t > r;
+      for( std::size_t i = 0; i < n; ++i ) if( get< $("qty") >( rows[ i ] ) >= 100 && get< $("qty") >( rows[ i ] ) <= 199 ) r.push_back( std::uint32_t( i ) );
+      return r.size(); } ) );
+
+  std::printf( "%-28s %7.2f ms %7.2f ms\n", "filter ts in a quarter",
+    run( [&]() { return store.filter< $("ts") >( t0, t1 ).size(); } ),
+    run( [&]() {
+      std::vector< std::uint32_t > r;
+      for( std::size_t i = 0; i < n; ++i ) if( get< $("ts") >( rows[ i ] ) >= t0 && get< $("ts") >( rows[ i ] ) <= t1 ) r.push_back( std::uint32_t( i ) );
+      return r.size(); } ) );
+
+  std::printf( "%-28s %7.2f ms %7.2f ms\n", "filter sym == one symbol",
+    run( [&]() { return store.filter< $("sym") >( [&]( std::string const & v ) { return v == sym; } ).size(); } ),
+    run( [&]() {
+      std::vector< std::uint32_t > r;
+      for( std::size_t i = 0; i < n; ++i ) if( get< $("sym") >( rows[ i ] ) == sym ) r.push_back( std::uint32_t( i ) );
+      return r.size(); } ) );
+
+  std::printf( "%-28s %7.2f ms %7.2f ms\n", "filter side == sell",
+    run( [&]() { return store.filter< $("side") >( side::sell, side::sell ).size(); } ),
+    run( [&]() {
+      std::vector< std::uint32_t > r;
+      for( std::size_t i = 0; i < n; ++i ) if( get< $("side") >( rows[ i ] ) == side::sell ) r.push_back( std::uint32_t( i ) );
+      return r.size(); } ) );
+
+  std::printf( "%-28s %7.2f ms %7.2f ms\n", "sum qty",
+    run( [&]() { long sum = 0; store.scan< $("qty") >( [&]( std::size_t, int q ) { sum += q; } ); return std::size_t( sum ); } ),
+    run( [&]() { long sum = 0; for( auto & r : rows ) sum += get< $("qty") >( r ); return std::size_t( sum ); } ) );
+}
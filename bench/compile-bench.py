@@ -0,0 +1,224 @@
+#!/usr/bin/env python3
+"""
+
+Compile-time cost benchmark for the headers in this repository
+
+Description:
+
+  The headers are template metaprograms and the price we pay for them is compile time.
+  This script generates a translation unit per (case, N) and compiles it, recording
+  wall time, peak memory of the compiler and template instantiation cost:
+
+    tlist_get       - luple_ns::tlist_get_t< type_list< N types >, i > for every i
+    filter_         - nuple< $("f0"), T0, ... > with N names (nuple_ns::filter_)
+    struct_reader   - struct_reader::as_type_list< struct with N fields >
+    loophole        - loophole_ns::as_type_list< struct with N fields > (fields_number)
+    intern          - N interned strings with N3599 literal operator templates
+
+  Instantiation cost is read from -ftime-trace (Clang: number of InstantiateClass and
+  InstantiateFunction events) or from -ftime-report (GCC: time spent in the
+  "template instantiation" phase).
+
+Usage:
+
+  bench/compile-bench.py [--cxx g++] [--sizes 8,16,32,64,128,256,512] [--cases ...]
+                         [--timeout 120] [--out bench/compile-bench.md]
+
+  The report is a markdown table, commit it together with changes to the metaprogramming
+  so the numbers can be compared in review.
+
+"""
+
+import argparse
+import json
+import os
+import platform
+import re
+import signal
+import subprocess
+import sys
+import tempfile
+import time
+
+
+ROOT = os.path.dirname( os.path.dirname( os.path.abspath( __file__ ) ) )
+
+SIZES = [ 8, 16, 32, 64, 128, 256, 512 ]
+
+#struct_reader only knows a fixed list of scalar types
+SCALARS = [ "int", "char", "float", "double", "short", "long", "unsigned int", "bool" ]
+
+
+def gen_tlist_get( n ):
+
+  types = ", ".join( "std::integral_constant<int, %d>" % i for i in range( n ) )
+  gets = "\n".join( "  + sizeof( luple_ns::tlist_get_t< list_t, %d > )" % i for i in range( n ) )
+
+  return ( '#include "luple.h"\n'
+           "using list_t = luple_ns::type_list< %s >;\n"
+           "int value = 0\n%s;\n" % ( types, gets ) )
+
+
+def gen_filter( n ):
+
+  args = ", ".join( '$("f%d"), %s' % ( i, SCALARS[ i % len( SCALARS ) ] ) for i in range( n ) )
+
+  return ( '#include "nuple.h"\n'
+           "using row_t = nuple< %s >;\n"
+           "int value = sizeof( row_t ) + nuple_ns::filter< %s >::nlist::size;\n" % ( args, args ) )
+
+
+def gen_struct( n ):
+
+  fields = "\n".join( "  %s f%d;" % ( SCALARS[ i % len( SCALARS ) ], i ) for i in range( n ) )
+
+  return "struct data {\n%s\n};\n" % fields
+
+
+def gen_struct_reader( n ):
+
+  return ( '#include "luple.h"\n#include "struct-reader.h"\n' + gen_struct( n ) +
+           "int value = struct_reader::as_type_list< data >::size;\n" )
+
+
+def gen_loophole( n ):
+
+  return ( '#include "type-loophole.h"\n' + gen_struct( n ) +
+           "int value = loophole_ns::as_type_list< data >::size;\n" )
+
+
+def gen_intern( n ):
+
+  names = ", ".join( '$("name_of_field_%d")' % i for i in range( n ) )
+
+  return ( '#include "luple.h"\n#include "intern.h"\n'
+           "using names_t = luple_ns::type_list< %s >;\n"
+           "int value = names_t::size;\n" % names )
+
+
+CASES = {
+  "tlist_get": gen_tlist_get,
+  "filter_": gen_filter,
+  "struct_reader": gen_struct_reader,
+  "loophole": gen_loophole,
+  "intern": gen_intern,
+}
+
+
+def is_clang( cxx ):
+
+  out = subprocess.run( [ cxx, "--version" ], stdout = subprocess.PIPE, universal_newlines = True ).stdout
+
+  return "clang" in out
+
+
+def compile_one( cxx, clang, src, workdir, timeout ):
+
+  obj = os.path.join( workdir, "out.o" )
+
+  cmd = [ cxx, "-std=c++17", "-c", "-I", ROOT, "-w", "-ftemplate-depth=8192", "-fconstexpr-depth=8192", src, "-o", obj ]
+
+  if clang:
+    cmd += [ "-ftime-trace", "-fconstexpr-steps=100000000" ]
+  else:
+    cmd += [ "-ftime-report", "-fconstexpr-ops-limit=4294967296" ]
+
+  #wait4 gives the resource usage of this particular child, ru_maxrss is in KiB on Linux
+  with open( os.path.join( workdir, "stderr.txt" ), "w+" ) as err:
+
+    start = time.monotonic()
+    #own process group, the driver forks cc1plus/clang -cc1 and a timeout has to kill both
+    proc = subprocess.Popen( cmd, stdout = subprocess.DEVNULL, stderr = err, start_new_session = True )
+
+    #poll so that a runaway instantiation can be killed, N=512 can take forever
+    while True:
+      pid, status, usage = os.wait4( proc.pid, os.WNOHANG )
+      if pid != 0: break
+      if time.monotonic() - start > timeout:
+        os.killpg( proc.pid, signal.SIGKILL )
+        os.wait4( proc.pid, 0 )
+        return time.monotonic() - start, "-", "timeout"
+      time.sleep( 0.01 )
+
+    wall = time.monotonic() - start
+
+    err.seek( 0 )
+    stderr = err.read()
+
+  peak = "%.1f" % ( usage.ru_maxrss / 1024.0 )
+
+  if status != 0:
+    errors = [ l for l in stderr.splitlines() if "error" in l ] or [ "?" ]
+    return wall, peak, "error: " + errors[ 0 ].split( "error:" )[ -1 ].strip()[ :60 ]
+
+  if clang:
+    trace = os.path.splitext( obj )[ 0 ] + ".json"
+    events = json.load( open( trace ) ).get( "traceEvents", [] )
+    names = ( "InstantiateClass", "InstantiateFunction" )
+    inst = "%d" % sum( 1 for e in events if e.get( "name" ) in names )
+  else:
+    m = re.search( r"template instantiation\s*:(?:\s*[\d.]+\s*\(\s*\d+%\)){2}\s*([\d.]+)", stderr )
+    inst = "%ss" % m.group( 1 ) if m else "-"
+
+  return wall, peak, inst
+
+
+def main():
+
+  ap = argparse.ArgumentParser( description = "compile-time cost of luple/nuple/intern/struct reader/loophole" )
+  ap.add_argument( "--cxx", default = os.environ.get( "CXX", "g++" ) )
+  ap.add_argument( "--sizes", default = ",".join( map( str, SIZES ) ) )
+  ap.add_argument( "--cases", default = ",".join( CASES ) )
+  ap.add_argument( "--timeout", type = float, default = 120, help = "seconds per translation unit" )
+  ap.add_argument( "--out", default = os.path.join( ROOT, "bench", "compile-bench.md" ) )
+  args = ap.parse_args()
+
+  sizes = [ int( s ) for s in args.sizes.split( "," ) ]
+  cases = args.cases.split( "," )
+  clang = is_clang( args.cxx )
+
+  version = subprocess.run( [ args.cxx, "--version" ], stdout = subprocess.PIPE,
+                            universal_newlines = True ).stdout.splitlines()[ 0 ]
+
+  inst_header = "instantiations" if clang else "instantiation time"
+
+  lines = [
+    "# Compile-time cost",
+    "",
+    "Generated by `bench/compile-bench.py`, compiler: `%s`, host: `%s`." % ( version, platform.machine() ),
+    "",
+    "Peak memory is the compiler's max RSS in MiB. A translation unit that takes longer",
+    "than %g s is killed and reported as `timeout`, larger N for that case are skipped." % args.timeout,
+    "",
+  ]
+
+  with tempfile.TemporaryDirectory() as workdir:
+
+    for case in cases:
+
+      lines += [ "## %s" % case, "", "| N | wall, s | peak, MiB | %s |" % inst_header, "|---:|---:|---:|---:|" ]
+
+      for n in sizes:
+
+        src = os.path.join( workdir, "%s_%d.cpp" % ( case, n ) )
+
+        with open( src, "w" ) as f:
+          f.write( CASES[ case ]( n ) )
+
+        wall, peak, inst = compile_one( args.cxx, clang, src, workdir, args.timeout )
+
+        lines.append( "| %d | %.2f | %s | %s |" % ( n, wall, peak, inst ) )
+
+        print( "%-14s N=%-4d %6.2fs %10s MiB %s" % ( case, n, wall, peak, inst ), file = sys.stderr )
+
+        #bigger N won't do any better
+        if inst == "timeout": break
+
+      lines.append( "" )
+
+  with open( args.out, "w" ) as f:
+    f.write( "\n".join( lines ) )
+
+
+if __name__ == "__main__":
+  main()
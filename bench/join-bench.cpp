@@ -0,0 +1,127 @@
+/*
+
+Joins of nuple tables (nuple-join.h) against nested loops and std::unordered_multimap
+
+Description:
+
+  fills (left, probe side) join orders (right, build side) on $("order_id"), every order has
+  about four fills. Prints milliseconds per join for hash_join with one and with all hardware
+  threads, merge_join on inputs that are already sorted, a join through a
+  std::unordered_multimap< int, int > of order ids to row ids, and nested loops. The nested
+  loops are timed on 1/100 of the orders (and their fills) and scaled up by 100^2.
+
+Usage:
+
+  g++ -std=c++17 -O2 -pthread -I.. join-bench.cpp -o join-bench && ./join-bench [orders]
+
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "nuple-join.h"
+
+
+using order_t = nuple< $("order_id"), int, $("sym"), int, $("px"), double >;
+using fill_t = nuple< $("fill_id"), int, $("order_id"), int, $("px"), double, $("qty"), int >;
+
+using row_t = join_row_t< fill_t, order_t, luple_ns::type_list< $("order_id") > >;
+
+
+template<typename F>
+double run ( F && join, std::size_t & rows ) {
+
+  auto start = std::chrono::steady_clock::now();
+
+  auto out = join();
+
+  std::chrono::duration< double, std::milli > time = std::chrono::steady_clock::now() - start;
+
+  rows = out.size();
+
+  return time.count();
+}
+
+std::vector< row_t > multimap_join ( std::vector< fill_t > const & fills, std::vector< order_t > const & orders ) {
+
+  std::unordered_multimap< int, int > index;
+
+  for( int i = 0; i < int( orders.size() ); ++i ) index.emplace( get< $("order_id") >( orders[ i ] ), i );
+
+  std::vector< row_t > out;
+
+  for( auto const & f : fills ) {
+
+    auto range = index.equal_range( get< $("order_id") >( f ) );
+
+    for( auto it = range.first; it != range.second; ++it ) out.push_back( nuple_ns::join_row< fill_t, order_t, luple_ns::type_list< $("order_id") > >::make( f, orders[ it->second ] ) );
+  }
+
+  return out;
+}
+
+std::vector< row_t > nested_join ( std::vector< fill_t > const & fills, std::vector< order_t > const & orders ) {
+
+  std::vector< row_t > out;
+
+  for( auto const & f : fills )
+
+    for( auto const & o : orders )
+
+      if( get< $("order_id") >( f ) == get< $("order_id") >( o ) ) out.push_back( nuple_ns::join_row< fill_t, order_t, luple_ns::type_list< $("order_id") > >::make( f, o ) );
+
+  return out;
+}
+
+
+int main ( int argc, char ** argv ) {
+
+  int orders_n = argc > 1 ? std::atoi( argv[1] ) : 1000000;
+  int threads = std::max( 1u, std::thread::hardware_concurrency() );
+
+  std::mt19937 rng{ 1 };
+
+  std::vector< order_t > orders;
+  std::vector< fill_t > fills;
+
+  for( int i = 0; i < orders_n; ++i ) orders.push_back( order_t{ i * 7, int( rng() % 500 ), 100. + i % 10 } );
+
+  for( int i = 0; i < orders_n * 4; ++i ) fills.push_back( fill_t{ i, int( rng() % orders_n ) * 7, 100.5, 1 + int( rng() % 100 ) } );
+
+  auto by_order = []( auto const & a, auto const & b ) { return get< $("order_id") >( a ) < get< $("order_id") >( b ); };
+
+  auto sorted_fills = fills;
+
+  std::stable_sort( sorted_fills.begin(), sorted_fills.end(), by_order );
+
+  std::size_t rows = 0;
+
+  std::printf( "%d orders, %zu fills\n%-24s %10s %10s\n", orders_n, fills.size(), "", "ms", "rows" );
+
+  double t = run( [&] { return hash_join< $("order_id") >( fills, orders ); }, rows );
+  std::printf( "%-24s %10.1f %10zu\n", "hash_join", t, rows );
+
+  t = run( [&] { return hash_join< $("order_id") >( fills, orders, threads ); }, rows );
+  std::printf( "%-24s %10.1f %10zu\n", ( "hash_join, " + std::to_string( threads ) + " threads" ).c_str(), t, rows );
+
+  t = run( [&] { return merge_join< $("order_id") >( sorted_fills, orders ); }, rows );
+  std::printf( "%-24s %10.1f %10zu\n", "merge_join (sorted)", t, rows );
+
+  t = run( [&] { return multimap_join( fills, orders ); }, rows );
+  std::printf( "%-24s %10.1f %10zu\n", "unordered_multimap", t, rows );
+
+  //1/100 of the orders and the fills that reference them
+  std::vector< order_t > few_orders( orders.begin(), orders.begin() + orders_n / 100 );
+  std::vector< fill_t > few_fills;
+
+  for( auto const & f : fills ) if( get< $("order_id") >( f ) < orders_n / 100 * 7 ) few_fills.push_back( f );
+
+  t = run( [&] { return nested_join( few_fills, few_orders ); }, rows );
+  std::printf( "%-24s %10.1f %10s\n", "nested loops (scaled)", t * 100 * 100, "-" );
+}
@@ -0,0 +1,79 @@
+/*
+
+Hot path cost of deferred-format logging (nuple-log.h) against formatting in place
+
+Description:
+
+  Logs batches of records that fit into the per-thread ring and drains them between
+  batches, only the time spent in the logging thread is measured. snprintf formats the
+  same values into a local buffer, the cost of a conventional logger before any I/O.
+  Prints nanoseconds per record.
+
+Usage:
+
+  g++ -std=c++17 -O2 -pthread -I.. log-bench.cpp -o log-bench && ./log-bench [records]
+
+*/
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#include "nuple-log.h"
+
+
+using order_t = nuple< $("id"), int, $("price"), double, $("qty"), int, $("side"), char >;
+
+const int batch = 4096;
+
+template<typename F>
+double run ( long records, F && f ) {
+
+  std::string text;
+  double total = 0;
+
+  for( long done = 0; done < records; done += batch ) {
+
+    auto start = std::chrono::steady_clock::now();
+
+    for( int i = 0; i < batch; ++i ) f( int( done + i ) );
+
+    std::chrono::duration< double > time = std::chrono::steady_clock::now() - start;
+
+    total += time.count();
+
+    text.clear();
+    nuple_log::drain( text );
+  }
+
+  return total / records * 1e9;
+}
+
+
+int main ( int argc, char ** argv ) {
+
+  long records = argc > 1 ? std::atol( argv[1] ) : 10000000;
+
+  char buf[ 256 ];
+
+  //warm up the ring and register the record types
+  run( batch, []( int i ) { nuple_log::log( order_t{ i, 10.5, 100, 'b' } ); } );
+  run( batch, []( int i ) { nuple_log::log( $name("order {} filled at {} x {}"), i, 10.5, 100 ); } );
+
+  double record = run( records, []( int i ) { nuple_log::log( order_t{ i, 10.5 + i, 100, 'b' } ); } );
+
+  double message = run( records, []( int i ) { nuple_log::log( $name("order {} filled at {} x {}"), i, 10.5 + i, 100 ); } );
+
+  double format = run( records, [&]( int i ) {
+
+    std::snprintf( buf, sizeof( buf ), "id=%d price=%.17g qty=%d side=%c", i, 10.5 + i, 100, 'b' );
+
+    asm volatile( "" : : "r"( buf ) : "memory" );
+  } );
+
+  std::printf( "%-28s %8.1f ns\n", "log( nuple )", record );
+  std::printf( "%-28s %8.1f ns\n", "log( format, args... )", message );
+  std::printf( "%-28s %8.1f ns\n", "snprintf", format );
+  std::printf( "dropped: %llu\n", (unsigned long long) nuple_log::dropped() );
+}
@@ -0,0 +1,190 @@
+/*
+
+Reads under concurrent writes: versioned_table (nuple-mvcc.h) against locking baselines
+
+Description:
+
+  A table of 65536 account rows. One writer thread moves an amount between two random rows
+  and commits, as fast as it can. Reader threads take a snapshot and look up 64 random rows.
+  Prints millions of row reads per second and thousands of writer commits per second.
+
+  Baselines: the same table in a std::vector behind a std::shared_mutex (readers share the
+  lock, the writer updates in place), and copy-on-write of the whole table (the writer copies
+  the vector on every commit and swaps a std::shared_ptr under a mutex).
+
+  With fewer cores than threads the numbers mostly measure the scheduler.
+
+Usage:
+
+  g++ -std=c++17 -O2 -pthread -I.. mvcc-bench.cpp -o mvcc-bench && ./mvcc-bench [readers] [milliseconds]
+
+*/
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <shared_mutex>
+#include <thread>
+#include <vector>
+
+#include "nuple-mvcc.h"
+
+
+using account_t = nuple< $("id"), int, $("balance"), double >;
+
+const int rows_n = 65536;
+const int reads_n = 64;
+
+
+struct mvcc_table {
+
+  mvcc_table () { for( int i = 0; i < rows_n; ++i ) _t.insert( account_t{ i, 100. } ); _t.commit(); }
+
+  double read ( std::mt19937 & rng ) {
+
+    auto s = _t.snapshot();
+
+    double sum = 0;
+
+    for( int i = 0; i < reads_n; ++i ) sum += get< $("balance") >( *s.find( rng() % rows_n ) );
+
+    return sum;
+  }
+
+  void write ( int a, int b ) {
+
+    _t.update( a, []( account_t & r ) { get< $("balance") >( r ) -= 1; } );
+    _t.update( b, []( account_t & r ) { get< $("balance") >( r ) += 1; } );
+    _t.commit();
+  }
+
+  versioned_table< account_t > _t;
+};
+
+struct shared_mutex_table {
+
+  shared_mutex_table () : _rows( rows_n ) { for( int i = 0; i < rows_n; ++i ) _rows[ i ] = account_t{ i, 100. }; }
+
+  double read ( std::mt19937 & rng ) {
+
+    std::shared_lock< std::shared_mutex > lock{ _m };
+
+    double sum = 0;
+
+    for( int i = 0; i < reads_n; ++i ) sum += get< $("balance") >( _rows[ rng() % rows_n ] );
+
+    return sum;
+  }
+
+  void write ( int a, int b ) {
+
+    std::unique_lock< std::shared_mutex > lock{ _m };
+
+    get< $("balance") >( _rows[ a ] ) -= 1;
+    get< $("balance") >( _rows[ b ] ) += 1;
+  }
+
+  std::shared_mutex _m;
+  std::vector< account_t > _rows;
+};
+
+struct copy_table {
+
+  copy_table () : _rows{ std::make_shared< std::vector< account_t > >( rows_n ) } {
+
+    for( int i = 0; i < rows_n; ++i ) ( *_rows )[ i ] = account_t{ i, 100. };
+  }
+
+  double read ( std::mt19937 & rng ) {
+
+    std::shared_ptr< std::vector< account_t > const > rows;
+
+    { std::lock_guard< std::mutex > lock{ _m }; rows = _rows; }
+
+    double sum = 0;
+
+    for( int i = 0; i < reads_n; ++i ) sum += get< $("balance") >( ( *rows )[ rng() % rows_n ] );
+
+    return sum;
+  }
+
+  void write ( int a, int b ) {
+
+    auto rows = std::make_shared< std::vector< account_t > >( *_rows );
+
+    get< $("balance") >( ( *rows )[ a ] ) -= 1;
+    get< $("balance") >( ( *rows )[ b ] ) += 1;
+
+    std::lock_guard< std::mutex > lock{ _m };
+
+    _rows = std::move( rows );
+  }
+
+  std::mutex _m;
+  std::shared_ptr< std::vector< account_t > > _rows;
+};
+
+
+template<typename T>
+void run ( char const * name, int readers, int ms ) {
+
+  T table;
+
+  std::atomic< bool > stop{ false };
+  std::atomic< long > reads{ 0 };
+  long writes = 0;
+
+  std::vector< std::thread > pool;
+
+  for( int r = 0; r < readers; ++r )
+
+    pool.emplace_back( [&, r] {
+
+      std::mt19937 rng( r + 1 );
+      long n = 0;
+      double sum = 0;
+
+      while( ! stop.load( std::memory_order_relaxed ) ) { sum += table.read( rng ); ++n; }
+
+      reads.fetch_add( n * reads_n );
+
+      if( sum == 42 ) std::puts( "" );
+    } );
+
+  std::thread writer{ [&] {
+
+    std::mt19937 rng{ 0 };
+
+    while( ! stop.load( std::memory_order_relaxed ) ) { table.write( rng() % rows_n, rng() % rows_n ); ++writes; }
+  } };
+
+  auto start = std::chrono::steady_clock::now();
+
+  std::this_thread::sleep_for( std::chrono::milliseconds( ms ) );
+
+  stop = true;
+
+  writer.join();
+  for( auto & t : pool ) t.join();
+
+  std::chrono::duration< double > time = std::chrono::steady_clock::now() - start;
+
+  std::printf( "%-22s %14.1f %14.1f\n", name, reads / time.count() / 1e6, writes / time.count() / 1e3 );
+}
+
+
+int main ( int argc, char ** argv ) {
+
+  int readers = argc > 1 ? std::atoi( argv[1] ) : 4;
+  int ms = argc > 2 ? std::atoi( argv[2] ) : 2000;
+
+  std::printf( "%d readers, 1 writer\n%-22s %14s %14s\n", readers, "", "Mreads/s", "Kcommits/s" );
+
+  run< mvcc_table >( "versioned_table", readers, ms );
+  run< shared_mutex_table >( "shared_mutex", readers, ms );
+  run< copy_table >( "copy whole table", readers, ms );
+}
@@ -0,0 +1,86 @@
+/*
+
+False sharing: per-thread counters in a luple against a padded_luple (luple.h)
+
+Description:
+
+  Every thread increments its own member of one shared record. In a luple the counters
+  share a cache line and the line bounces between cores on every increment, in a
+  padded_luple every counter has its own line. Prints millions of increments per second
+  summed over the threads.
+
+Usage:
+
+  g++ -std=c++17 -O2 -pthread -I.. padded-bench.cpp -o padded-bench && ./padded-bench [increments per thread]
+
+*/
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#include "luple.h"
+
+
+using counter_t = std::atomic< std::uint64_t >;
+
+template<typename L, int... NN>
+double run ( std::uint64_t increments, int threads, std::integer_sequence<int, NN...> ) {
+
+  L counters;
+
+  luple_do( counters, []( auto & c ) { c.store( 0 ); } );
+
+  //pointer to the counter of every thread
+  counter_t * members[] = { &get<NN>( counters )... };
+
+  std::vector< std::thread > pool;
+
+  auto start = std::chrono::steady_clock::now();
+
+  for( int t = 0; t < threads; ++t )
+
+    pool.emplace_back( [=] {
+
+      counter_t & c = *members[ t ];
+
+      //a load and a store, not an atomic increment: only the cache line traffic is measured
+      for( std::uint64_t i = 0; i < increments; ++i ) c.store( c.load( std::memory_order_relaxed ) + 1, std::memory_order_relaxed );
+    } );
+
+  for( auto & t : pool ) t.join();
+
+  std::chrono::duration< double > time = std::chrono::steady_clock::now() - start;
+
+  return increments * threads / time.count() / 1e6;
+}
+
+template<int... NN>
+using plain_t = luple< std::conditional_t< NN >= 0, counter_t, void >... >;
+
+template<int... NN>
+using padded_t = padded_luple< std::conditional_t< NN >= 0, counter_t, void >... >;
+
+template<int... NN>
+void bench ( std::uint64_t increments, std::integer_sequence<int, NN...> seq ) {
+
+  int max_threads = std::thread::hardware_concurrency() < sizeof...(NN) ? std::thread::hardware_concurrency() : sizeof...(NN);
+
+  std::printf( "%8s %14s %14s   (Mincrements/s), sizeof: %d vs %d\n", "threads", "luple", "padded_luple",
+    (int) sizeof( plain_t<NN...> ), (int) sizeof( padded_t<NN...> ) );
+
+  for( int t = 1; t <= max_threads; t *= 2 )
+
+    std::printf( "%8d %14.1f %14.1f\n", t, run< plain_t<NN...> >( increments, t, seq ), run< padded_t<NN...> >( increments, t, seq ) );
+}
+
+
+int main ( int argc, char ** argv ) {
+
+  std::uint64_t increments = argc > 1 ? std::atoll( argv[1] ) : 50000000;
+
+  bench( increments, std::make_integer_sequence< int, 8 >{} );
+}
@@ -0,0 +1,213 @@
+/*
+
+Queues of luple records: spsc_queue and mpmc_queue (luple-queue.h) against a mutex and a std::deque
+
+Description:
+
+  Throughput: producers push a fixed number of records in batches, consumers pop them in
+  batches of the same size. Prints millions of records per second for 1:1 and N:M setups
+  with batches of 1 and 64 records.
+
+  Latency: ping-pong between two threads over two queues, prints half of the median and
+  the 99th percentile round trip in nanoseconds.
+
+  With fewer cores than threads the numbers mostly measure the scheduler.
+
+Usage:
+
+  g++ -std=c++17 -O2 -pthread -I.. queue-bench.cpp -o queue-bench && ./queue-bench [records]
+
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "luple-queue.h"
+
+
+using record_t = luple_ns::type_list< std::uint64_t, double, int, int >;
+using value_t = luple_t< record_t >;
+
+
+//the baseline: std::deque behind a mutex, with the same interface
+struct mutex_queue {
+
+  explicit mutex_queue ( std::size_t capacity ) : _capacity{ capacity } {}
+
+  std::size_t push_n ( value_t const * in, std::size_t n ) {
+
+    std::lock_guard< std::mutex > lock{ _m };
+
+    n = std::min( n, _capacity - _q.size() );
+
+    _q.insert( _q.end(), in, in + n );
+
+    return n;
+  }
+
+  std::size_t pop_n ( value_t * out, std::size_t n ) {
+
+    std::lock_guard< std::mutex > lock{ _m };
+
+    n = std::min( n, _q.size() );
+
+    std::copy( _q.begin(), _q.begin() + n, out );
+
+    _q.erase( _q.begin(), _q.begin() + n );
+
+    return n;
+  }
+
+  std::size_t _capacity;
+  std::mutex _m;
+  std::deque< value_t > _q;
+};
+
+
+template<typename Q>
+void push_all ( Q & q, value_t const * in, std::size_t n ) {
+
+  for( std::size_t done = 0; done < n; ) {
+
+    auto k = q.push_n( in + done, n - done );
+
+    if( ! k ) std::this_thread::yield();
+
+    done += k;
+  }
+}
+
+template<typename Q>
+double throughput ( std::size_t records, int producers, int consumers, std::size_t batch ) {
+
+  Q q{ 4096 };
+
+  std::size_t per_producer = records / producers;
+  std::size_t total = per_producer * producers;
+
+  std::atomic< std::size_t > popped{ 0 };
+  std::vector< std::thread > pool;
+
+  auto start = std::chrono::steady_clock::now();
+
+  for( int p = 0; p < producers; ++p )
+
+    pool.emplace_back( [&, p] {
+
+      std::vector< value_t > buf( batch );
+
+      for( std::size_t i = 0; i < per_producer; i += batch ) {
+
+        auto n = std::min( batch, per_producer - i );
+
+        for( std::size_t k = 0; k < n; ++k ) buf[ k ] = value_t{ std::uint64_t( i + k ), 1.0, p, 0 };
+
+        push_all( q, buf.data(), n );
+      }
+    } );
+
+  for( int c = 0; c < consumers; ++c )
+
+    pool.emplace_back( [&] {
+
+      std::vector< value_t > buf( batch );
+
+      while( popped.load( std::memory_order_relaxed ) < total ) {
+
+        auto n = q.pop_n( buf.data(), batch );
+
+        if( n ) popped.fetch_add( n, std::memory_order_relaxed ); else std::this_thread::yield();
+      }
+    } );
+
+  for( auto & t : pool ) t.join();
+
+  std::chrono::duration< double > time = std::chrono::steady_clock::now() - start;
+
+  return total / time.count() / 1e6;
+}
+
+template<typename Q>
+void latency ( int rounds, double & median, double & p99 ) {
+
+  Q ping{ 64 }, pong{ 64 };
+
+  std::thread echo{ [&] {
+
+    value_t v;
+
+    for( int i = 0; i < rounds; ++i ) {
+
+      while( ! ping.pop_n( &v, 1 ) ) std::this_thread::yield();
+
+      push_all( pong, &v, 1 );
+    }
+  } };
+
+  std::vector< double > times( rounds );
+
+  value_t v{ std::uint64_t( 0 ), 0.0, 0, 0 };
+
+  for( int i = 0; i < rounds; ++i ) {
+
+    auto start = std::chrono::steady_clock::now();
+
+    push_all( ping, &v, 1 );
+
+    while( ! pong.pop_n( &v, 1 ) ) std::this_thread::yield();
+
+    times[ i ] = std::chrono::duration< double, std::nano >( std::chrono::steady_clock::now() - start ).count() / 2;
+  }
+
+  echo.join();
+
+  std::sort( times.begin(), times.end() );
+
+  median = times[ rounds / 2 ];
+  p99 = times[ rounds * 99 / 100 ];
+}
+
+
+int main ( int argc, char ** argv ) {
+
+  std::size_t records = argc > 1 ? std::atoll( argv[1] ) : 10000000;
+
+  std::printf( "throughput, Mrecords/s\n%-12s %6s %14s %14s %14s %14s\n", "threads", "batch", "spsc_queue", "spsc soa", "mpmc_queue", "mutex+deque" );
+
+  for( std::size_t batch : { 1, 64 } )
+
+    std::printf( "%-12s %6d %14.1f %14.1f %14.1f %14.1f\n", "1:1", int( batch ),
+      throughput< spsc_queue< record_t > >( records, 1, 1, batch ),
+      throughput< spsc_queue< record_t, queue_soa > >( records, 1, 1, batch ),
+      throughput< mpmc_queue< record_t > >( records, 1, 1, batch ),
+      throughput< mutex_queue >( records, 1, 1, batch ) );
+
+  for( int n : { 2, 4 } )
+
+    for( std::size_t batch : { 1, 64 } )
+
+      std::printf( "%-12s %6d %14s %14s %14.1f %14.1f\n", ( std::to_string( n ) + ":" + std::to_string( n ) ).c_str(), int( batch ), "-", "-",
+        throughput< mpmc_queue< record_t > >( records, n, n, batch ),
+        throughput< mutex_queue >( records, n, n, batch ) );
+
+  int rounds = 100000;
+  double median, p99;
+
+  std::printf( "\nlatency (one way), ns\n%-14s %10s %10s\n", "", "median", "p99" );
+
+  latency< spsc_queue< record_t > >( rounds, median, p99 );
+  std::printf( "%-14s %10.0f %10.0f\n", "spsc_queue", median, p99 );
+
+  latency< mpmc_queue< record_t > >( rounds, median, p99 );
+  std::printf( "%-14s %10.0f %10.0f\n", "mpmc_queue", median, p99 );
+
+  latency< mutex_queue >( rounds, median, p99 );
+  std::printf( "%-14s %10.0f %10.0f\n", "mutex+deque", median, p99 );
+}
@@ -0,0 +1,124 @@
+/*
+
+Reader scaling of seqlock_luple (luple-seqlock.h) against a mutex and an atomic shared_ptr
+
+Description:
+
+  One writer stores a luple< double, double, std::int64_t, std::int64_t > in a loop, 1..N
+  readers load it and check that the snapshot is consistent (all members are derived from
+  the same counter). Prints millions of reads per second summed over the readers.
+
+Usage:
+
+  g++ -std=c++17 -O2 -pthread -I.. seqlock-bench.cpp -o seqlock-bench && ./seqlock-bench [seconds per run]
+
+*/
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "luple-seqlock.h"
+
+
+using state_list = luple_ns::type_list< double, double, std::int64_t, std::int64_t >;
+using state_t = luple_t< state_list >;
+
+state_t make_state ( std::int64_t i ) { return state_t{ double( i ), double( i ) * 2, i, -i }; }
+
+bool consistent ( state_t const & s ) {
+
+  std::int64_t i = get<2>( s );
+
+  return get<0>( s ) == double( i ) && get<1>( s ) == double( i ) * 2 && get<3>( s ) == -i;
+}
+
+
+struct seqlock_store {
+
+  seqlock_luple< state_list > s;
+
+  void store ( state_t const & v ) { s.store( v ); }
+  state_t load () { return s.load(); }
+};
+
+struct mutex_store {
+
+  std::mutex m;
+  state_t s = make_state( 0 );
+
+  void store ( state_t const & v ) { std::lock_guard< std::mutex > l{ m }; s = v; }
+  state_t load () { std::lock_guard< std::mutex > l{ m }; return s; }
+};
+
+struct shared_ptr_store {
+
+  std::shared_ptr< state_t > s = std::make_shared< state_t >( make_state( 0 ) );
+
+  void store ( state_t const & v ) { std::atomic_store( &s, std::make_shared< state_t >( v ) ); }
+  state_t load () { return *std::atomic_load( &s ); }
+};
+
+
+template<typename S>
+double run ( int readers, double seconds ) {
+
+  S store;
+  std::atomic< bool > stop{ false };
+  std::atomic< std::uint64_t > reads{ 0 }, torn{ 0 };
+
+  std::thread writer{ [&] {
+
+    for( std::int64_t i = 1; ! stop.load( std::memory_order_relaxed ); ++i ) store.store( make_state( i ) );
+  } };
+
+  std::vector< std::thread > pool;
+
+  for( int r = 0; r < readers; ++r )
+
+    pool.emplace_back( [&] {
+
+      std::uint64_t n = 0, bad = 0;
+
+      while( ! stop.load( std::memory_order_relaxed ) ) {
+
+        bad += ! consistent( store.load() );
+        n++;
+      }
+
+      reads += n;
+      torn += bad;
+    } );
+
+  std::this_thread::sleep_for( std::chrono::duration< double >( seconds ) );
+
+  stop = true;
+
+  writer.join();
+
+  for( auto & t : pool ) t.join();
+
+  if( torn ) std::printf( "torn reads: %llu\n", (unsigned long long) torn.load() );
+
+  return reads / seconds / 1e6;
+}
+
+
+int main ( int argc, char ** argv ) {
+
+  double seconds = argc > 1 ? std::atof( argv[1] ) : 1.0;
+
+  int max_readers = std::thread::hardware_concurrency() > 2 ? std::thread::hardware_concurrency() - 1 : 1;
+
+  std::printf( "%8s %14s %14s %14s   (Mreads/s)\n", "readers", "seqlock", "mutex", "shared_ptr" );
+
+  for( int r = 1; r <= max_readers; r *= 2 )
+
+    std::printf( "%8d %14.1f %14.1f %14.1f\n", r,
+      run< seqlock_store >( r, seconds ), run< mutex_store >( r, seconds ), run< shared_ptr_store >( r, seconds ) );
+}
@@ -0,0 +1,101 @@
+/*
+
+Lookups in static tables built at compile time (luple-table.h) against std::lower_bound
+
+Description:
+
+  A table of 4096 luple< int, int, double > rows with scattered keys is built at compile time
+  in every layout. The baseline is the same rows sorted at startup in a std::vector and
+  searched with std::lower_bound. Half of the looked up keys are present. Prints nanoseconds
+  per lookup.
+
+Usage:
+
+  g++ -std=c++17 -O2 -I.. table-bench.cpp -o table-bench && ./table-bench [lookups]
+
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "luple-table.h"
+
+
+using row_t = luple< int, int, double >;
+
+const int rows_n = 4096;
+
+struct rows_t {
+
+  row_t rows[ rows_n ];
+};
+
+//keys are 2 * ( i * 2654435761 mod 2^20 ): unique, scattered, even
+constexpr rows_t make_rows () {
+
+  rows_t r{};
+
+  for( int i = 0; i < rows_n; ++i ) r.rows[ i ] = row_t{ int( ( i * 2654435761u ) % ( 1u << 20 ) ) * 2, i, i * 0.5 };
+
+  return r;
+}
+
+constexpr rows_t source = make_rows();
+
+constexpr auto sorted = make_static_table< keys< 0 > >( source.rows );
+constexpr auto eytzinger = make_static_table< keys< 0 >, table_eytzinger >( source.rows );
+constexpr auto hashed = make_static_table< keys< 0 >, table_hash >( source.rows );
+
+
+template<typename F>
+double run ( std::vector< int > const & keys, F && find ) {
+
+  long sum = 0;
+
+  auto start = std::chrono::steady_clock::now();
+
+  for( int k : keys ) {
+
+    row_t const * r = find( k );
+
+    sum += r ? get< 1 >( *r ) : 0;
+  }
+
+  std::chrono::duration< double, std::nano > time = std::chrono::steady_clock::now() - start;
+
+  if( sum == 42 ) std::puts( "" );
+
+  return time.count() / keys.size();
+}
+
+
+int main ( int argc, char ** argv ) {
+
+  std::size_t lookups = argc > 1 ? std::atoll( argv[1] ) : 10000000;
+
+  std::vector< row_t > runtime( source.rows, source.rows + rows_n );
+
+  std::sort( runtime.begin(), runtime.end(), []( row_t const & a, row_t const & b ) { return get< 0 >( a ) < get< 0 >( b ); } );
+
+  std::mt19937 rng{ 1 };
+  std::vector< int > keys( lookups );
+
+  //every other lookup misses (odd key)
+  for( std::size_t i = 0; i < lookups; ++i ) keys[ i ] = get< 0 >( source.rows[ rng() % rows_n ] ) + int( i & 1 );
+
+  auto lower = [&]( int k ) -> row_t const * {
+
+    auto it = std::lower_bound( runtime.begin(), runtime.end(), k, []( row_t const & r, int k ) { return get< 0 >( r ) < k; } );
+
+    return it != runtime.end() && get< 0 >( *it ) == k ? &*it : nullptr;
+  };
+
+  std::printf( "%-22s %8.1f ns\n", "std::lower_bound", run( keys, lower ) );
+  std::printf( "%-22s %8.1f ns\n", "table_sorted", run( keys, []( int k ) { return sorted.find( k ); } ) );
+  std::printf( "%-22s %8.1f ns\n", "table_eytzinger", run( keys, []( int k ) { return eytzinger.find( k ); } ) );
+  std::printf( "%-22s %8.1f ns\n", "table_hash", run( keys, []( int k ) { return hashed.find( k ); } ) );
+}
@@ -55,6 +55,8 @@ Usage:
 
 */
 
+#ifndef INTERN_INTERN_H
+#define INTERN_INTERN_H
 
 //Use N3599 proposal by default on GCC and Clang
 
@@ -107,4 +109,4 @@ namespace intern {
 
 #endif
 
-
+#endif // INTERN_INTERN_H
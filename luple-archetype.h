@@ -0,0 +1,550 @@
+/*
+
+luple-archetype: entities grouped by component set, stored column-wise in chunks (C++14)
+
+License: Public-domain software
+
+Description:
+
+  entity_store< type_list< Pos, Vel >, type_list< Pos >, ... > keeps entities grouped by
+  archetype, the set of components an entity has. Every archetype is a type_list known at
+  compile time. Its rows live in fixed-size chunks (LUPLE_CHUNK_SIZE bytes), inside a chunk
+  every component is a contiguous column, followed by a column of entity indices.
+
+  each< Pos, Vel >( f ) visits all archetypes that have both components (selected at compile
+  time, columns found with tlist_get_n) and calls f( pos, vel ) over the columns of every
+  chunk: a linear walk over plain arrays.
+
+  An entity handle is an index and a generation, it maps to ( archetype, row ). Removing a
+  row moves the last row of the archetype into the hole, so rows stay dense. Moving an
+  entity to another archetype copies the shared components with memcpy, components that
+  the destination lacks are dropped, new ones are passed in or value-initialized.
+  move_all< From, To >() relocates all entities of an archetype with one memcpy per column
+  for every run of rows that doesn't cross a chunk boundary.
+
+  A handle of a destroyed entity is stale: alive() is false, find() returns nullptr, get()
+  asserts, destroy() and move() do nothing and archetype() is -1.
+
+  Components should be trivially copyable, with alignment not above std::max_align_t.
+  Adding entities invalidates references to components, moving or destroying one
+  invalidates references to the last row of the archetypes involved.
+
+Dependencies:
+
+  luple.h: type_list, tlist_get_n, tlist_get_t
+  vector, memory, cstring, cstddef, cstdint, cassert
+
+Usage:
+
+  #include "luple-archetype.h"
+
+  struct pos { float x, y; };
+  struct vel { float x, y; };
+  struct health { int hp; };
+
+  using world_t = entity_store< luple_ns::type_list< pos, vel >, luple_ns::type_list< pos >,
+                                luple_ns::type_list< pos, vel, health > >;
+  world_t w;
+
+  auto e = w.create( pos{ 0, 0 }, vel{ 1, 1 } ); //type_list< pos, vel >
+  auto s = w.create( pos{ 5, 5 } );              //type_list< pos >
+
+  w.each< pos, vel >( []( pos & p, vel const & v ) { p.x += v.x; p.y += v.y; } );
+
+  w.get< pos >( e ).x = 10;
+  vel * v = w.find< vel >( s ); //nullptr
+
+  w.move< luple_ns::type_list< pos, vel, health > >( e, health{ 100 } );
+  w.move_all< luple_ns::type_list< pos >, luple_ns::type_list< pos, vel > >(); //vel{} for all
+
+  w.destroy( s );
+
+*/
+
+#ifndef LUPLE_ARCHETYPE_H
+#define LUPLE_ARCHETYPE_H
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <vector>
+#include <type_traits>
+
+#include "luple.h"
+
+//bytes per chunk of rows
+#ifndef LUPLE_CHUNK_SIZE
+#define LUPLE_CHUNK_SIZE 16384
+#endif
+
+
+namespace luple_ns {
+
+
+  //chunk layout: a column per component and a column of entity indices
+
+  template<typename... CC>
+  constexpr std::size_t archetype_offset ( int column, std::size_t capacity ) {
+
+    std::size_t const sizes[] = { sizeof( CC )..., sizeof( std::uint32_t ) };
+    std::size_t const aligns[] = { alignof( CC )..., alignof( std::uint32_t ) };
+
+    std::size_t offset = 0;
+
+    for( int i = 0; i <= column; ++i ) {
+
+      offset = ( offset + aligns[ i ] - 1 ) / aligns[ i ] * aligns[ i ];
+
+      if( i < column ) offset += capacity * sizes[ i ];
+    }
+
+    return offset;
+  }
+
+  //rows per chunk
+  template<typename... CC>
+  constexpr int archetype_capacity () {
+
+    std::size_t const sizes[] = { sizeof( CC )..., sizeof( std::uint32_t ) };
+
+    std::size_t row = 0;
+
+    for( auto s : sizes ) row += s;
+
+    std::size_t capacity = LUPLE_CHUNK_SIZE / row;
+
+    //alignment padding between columns
+    while( archetype_offset< CC... >( sizeof...(CC), capacity ) + capacity * sizeof( std::uint32_t ) > LUPLE_CHUNK_SIZE ) --capacity;
+
+    return int( capacity );
+  }
+
+  template<typename... CC>
+  constexpr bool archetype_components () {
+
+    bool const ok[] = { ( std::is_trivially_copyable<CC>::value && alignof( CC ) <= alignof( std::max_align_t ) )..., true };
+
+    for( bool b : ok ) if( ! b ) return false;
+
+    return true;
+  }
+
+
+  struct archetype_chunk {
+
+    alignas( std::max_align_t ) char data[ LUPLE_CHUNK_SIZE ];
+  };
+
+
+  //rows of one archetype, the column layout comes from archetype_layout
+
+  struct archetype_rows {
+
+    int capacity;
+    int columns;
+    std::size_t const * offsets;
+    std::size_t const * sizes;
+
+    int size = 0;
+
+    std::vector< std::unique_ptr< archetype_chunk > > chunks;
+
+    char * at ( int column, int row ) const {
+
+      return chunks[ row / capacity ]->data + offsets[ column ] + std::size_t( row % capacity ) * sizes[ column ];
+    }
+
+    std::uint32_t entity ( int row ) const {
+
+      std::uint32_t id;
+
+      std::memcpy( &id, at( columns - 1, row ), sizeof( id ) );
+
+      return id;
+    }
+
+    int push () {
+
+      if( size == capacity * int( chunks.size() ) ) chunks.emplace_back( new archetype_chunk );
+
+      return size++;
+    }
+
+    //the last row goes into the hole, returns true if a row was moved
+    bool remove ( int row ) {
+
+      int last = --size;
+
+      if( row != last )
+
+        for( int c = 0; c < columns; ++c ) std::memcpy( at( c, row ), at( c, last ), sizes[ c ] );
+
+      if( last % capacity == 0 ) chunks.pop_back();
+
+      return row != last;
+    }
+  };
+
+
+  template<typename T> struct archetype_layout;
+
+  template<typename... CC> struct archetype_layout< type_list<CC...> > {
+
+    static_assert( archetype_components< CC... >(), "components should be trivially copyable and not over-aligned" );
+
+    static const int capacity = archetype_capacity< CC... >();
+
+    static_assert( capacity > 0, "a row doesn't fit into LUPLE_CHUNK_SIZE" );
+
+    static constexpr std::size_t sizes[] = { sizeof( CC )..., sizeof( std::uint32_t ) };
+
+    static constexpr std::size_t offsets[] = { archetype_offset< CC... >( tlist_get_n< type_list<CC...>, CC >::value, capacity )...,
+                                               archetype_offset< CC... >( sizeof...(CC), capacity ) };
+  };
+
+  template<typename... CC>
+  constexpr std::size_t archetype_layout< type_list<CC...> >::sizes[];
+
+  template<typename... CC>
+  constexpr std::size_t archetype_layout< type_list<CC...> >::offsets[];
+
+
+  //does archetype A have all components CC...
+  template<typename A, typename... CC>
+  constexpr bool archetype_has () {
+
+    int const n[] = { tlist_get_n< A, CC >::value..., 0 };
+
+    for( int i : n ) if( i == -1 ) return false;
+
+    return true;
+  }
+
+
+  //AA... - type_list< components... > for every archetype
+
+  template<typename... AA>
+  struct entity_store {
+
+    static_assert( sizeof...(AA) > 0, "no archetypes" );
+
+    using archetype_list = type_list< AA... >;
+
+    struct entity {
+
+      std::uint32_t index;
+      std::uint32_t generation;
+
+      bool operator == ( entity const & r ) const { return index == r.index && generation == r.generation; }
+      bool operator != ( entity const & r ) const { return !( *this == r ); }
+    };
+
+    entity_store () : _rows{ { archetype_layout<AA>::capacity, AA::size + 1, archetype_layout<AA>::offsets, archetype_layout<AA>::sizes, 0, {} }... } {}
+
+
+    //create( components... ), the component types select the archetype
+    template<typename... CC>
+    entity create ( CC const &... components ) {
+
+      const int a = tlist_get_n< archetype_list, type_list<CC...> >::value;
+
+      static_assert( a != -1, "no archetype with these components" );
+
+      auto & rows = _rows[ a ];
+
+      int row = rows.push();
+
+      entity e = new_entity_( a, row );
+
+      write_( rows, row, type_list<CC...>{}, components... );
+
+      std::memcpy( rows.at( components_( a ), row ), &e.index, sizeof( e.index ) );
+
+      return e;
+    }
+
+    void destroy ( entity e ) {
+
+      if( ! alive( e ) ) return;
+
+      auto & s = _slots[ e.index ];
+
+      remove_( s.archetype, s.row );
+
+      s.archetype = -1;
+      s.generation++;
+
+      _free.push_back( e.index );
+    }
+
+    bool alive ( entity e ) const { return e.index < _slots.size() && _slots[ e.index ].generation == e.generation; }
+
+
+    //component of an entity, nullptr if its archetype doesn't have it
+    template<typename C>
+    C * find ( entity e ) {
+
+      if( ! alive( e ) ) return nullptr;
+
+      auto & s = _slots[ e.index ];
+
+      int column = column_<C>( s.archetype );
+
+      return column == -1 ? nullptr : reinterpret_cast< C * >( _rows[ s.archetype ].at( column, s.row ) );
+    }
+
+    template<typename C>
+    C & get ( entity e ) {
+
+      C * c = find<C>( e );
+
+      assert( c && "stale entity or no such component" );
+
+      return *c;
+    }
+
+    //archetype index of an entity (in AA...), -1 for a stale handle
+    int archetype ( entity e ) const { return alive( e ) ? _slots[ e.index ].archetype : -1; }
+
+
+    //move an entity to archetype A: shared components are copied, new ones are taken from
+    //the arguments or value-initialized
+    template<typename A, typename... CC>
+    void move ( entity e, CC const &... components ) {
+
+      const int to = tlist_get_n< archetype_list, A >::value;
+
+      static_assert( to != -1, "no such archetype" );
+      static_assert( archetype_has< A, CC... >(), "the archetype doesn't have these components" );
+
+      if( ! alive( e ) ) return;
+
+      auto & s = _slots[ e.index ];
+
+      if( s.archetype != to ) {
+
+        auto & dst = _rows[ to ];
+
+        int row = dst.push();
+
+        relocate_( s.archetype, s.row, dst, row, 1, A{}, std::make_integer_sequence< int, A::size >{} );
+
+        std::memcpy( dst.at( A::size, row ), &e.index, sizeof( e.index ) );
+
+        remove_( s.archetype, s.row );
+
+        s.archetype = to;
+        s.row = row;
+      }
+
+      write_( _rows[ to ], s.row, A{}, components... );
+    }
+
+
+    //move all entities of archetype From to archetype To
+    template<typename From, typename To>
+    void move_all () {
+
+      const int from = tlist_get_n< archetype_list, From >::value;
+      const int to = tlist_get_n< archetype_list, To >::value;
+
+      static_assert( from != -1 && to != -1, "no such archetype" );
+
+      if( from == to ) return;
+
+      auto & src = _rows[ from ];
+      auto & dst = _rows[ to ];
+
+      int base = dst.size;
+
+      //reserve the rows, then copy runs that stay inside one chunk of both archetypes
+      for( int i = 0; i < src.size; ++i ) dst.push();
+
+      for( int i = 0; i < src.size; ) {
+
+        int r = base + i;
+        int n = src.capacity - i % src.capacity;
+
+        if( n > dst.capacity - r % dst.capacity ) n = dst.capacity - r % dst.capacity;
+        if( n > src.size - i ) n = src.size - i;
+
+        relocate_( from, i, dst, r, n, To{}, std::make_integer_sequence< int, To::size >{} );
+
+        std::memcpy( dst.at( To::size, r ), src.at( From::size, i ), n * sizeof( std::uint32_t ) );
+
+        i += n;
+      }
+
+      for( int i = 0; i < src.size; ++i ) {
+
+        auto & s = _slots[ dst.entity( base + i ) ];
+
+        s.archetype = to;
+        s.row = base + i;
+      }
+
+      src.size = 0;
+      src.chunks.clear();
+    }
+
+
+    //f( CC &... ) for every entity that has all of CC...
+    template<typename... CC, typename F>
+    void each ( F && f ) {
+
+      each_< CC... >( f, std::make_integer_sequence< int, sizeof...(AA) >{} );
+    }
+
+
+    //number of entities
+    int size () const {
+
+      int n = 0;
+
+      for( auto & r : _rows ) n += r.size;
+
+      return n;
+    }
+
+    template<typename A>
+    int size () const {
+
+      static_assert( tlist_get_n< archetype_list, A >::value != -1, "no such archetype" );
+
+      return _rows[ tlist_get_n< archetype_list, A >::value ].size;
+    }
+
+  private:
+
+    struct slot {
+
+      int archetype;
+      int row;
+      std::uint32_t generation;
+    };
+
+    static int components_ ( int a ) {
+
+      static const int sizes[] = { AA::size... };
+
+      return sizes[ a ];
+    }
+
+    //column of component C in archetype a or -1
+    template<typename C>
+    static int column_ ( int a ) {
+
+      static const int columns[] = { tlist_get_n< AA, C >::value... };
+
+      return columns[ a ];
+    }
+
+    entity new_entity_ ( int a, int row ) {
+
+      std::uint32_t index;
+
+      if( _free.empty() ) {
+
+        index = std::uint32_t( _slots.size() );
+
+        _slots.push_back( slot{ a, row, 0 } );
+
+      } else {
+
+        index = _free.back();
+
+        _free.pop_back();
+
+        _slots[ index ].archetype = a;
+        _slots[ index ].row = row;
+      }
+
+      return entity{ index, _slots[ index ].generation };
+    }
+
+    void remove_ ( int a, int row ) {
+
+      auto & rows = _rows[ a ];
+
+      if( rows.remove( row ) ) _slots[ rows.entity( row ) ].row = row;
+    }
+
+    template<typename A, typename... CC>
+    static void write_ ( archetype_rows & rows, int row, A, CC const &... components ) {
+
+      char dummy[] = { ( std::memcpy( rows.at( tlist_get_n< A, CC >::value, row ), &components, sizeof( CC ) ), char{} )..., char{} };
+      (void) dummy; (void) rows; (void) row;
+    }
+
+    //n rows from archetype from into the columns of A, the rows stay inside one chunk
+    template<typename A, int... NN>
+    void relocate_ ( int from, int src_row, archetype_rows & dst, int row, int n, A, std::integer_sequence<int, NN...> ) {
+
+      char dummy[] = { ( relocate_one_< tlist_get_t< A, NN > >( from, src_row, dst.at( NN, row ), n ), char{} )..., char{} };
+      (void) dummy;
+    }
+
+    //n rows of component C from archetype from (or value-initialized) into out
+    template<typename C>
+    void relocate_one_ ( int from, int src_row, char * out, int n ) {
+
+      int column = column_<C>( from );
+
+      if( column != -1 ) std::memcpy( out, _rows[ from ].at( column, src_row ), n * sizeof( C ) );
+
+      else for( int i = 0; i < n; ++i ) {
+
+        C value{};
+
+        std::memcpy( out + i * sizeof( C ), &value, sizeof( C ) );
+      }
+    }
+
+    template<typename... CC, typename F, int... NN>
+    void each_ ( F & f, std::integer_sequence<int, NN...> ) {
+
+      char dummy[] = { ( each_archetype_< NN, CC... >( f, std::integral_constant< bool, archetype_has< AA, CC... >() >{} ), char{} )..., char{} };
+      (void) dummy;
+    }
+
+    template<int N, typename... CC, typename F>
+    void each_archetype_ ( F &, std::false_type ) {}
+
+    template<int N, typename... CC, typename F>
+    void each_archetype_ ( F & f, std::true_type ) {
+
+      using A = tlist_get_t< archetype_list, N >;
+
+      auto & rows = _rows[ N ];
+
+      for( int c = 0, left = rows.size; left > 0; ++c, left -= rows.capacity ) {
+
+        char * data = rows.chunks[ c ]->data;
+
+        each_chunk_( f, left < rows.capacity ? left : rows.capacity,
+                     reinterpret_cast< CC * >( data + rows.offsets[ tlist_get_n< A, CC >::value ] )... );
+      }
+    }
+
+    template<typename F, typename... CC>
+    static void each_chunk_ ( F & f, int n, CC *... columns ) {
+
+      for( int i = 0; i < n; ++i ) f( columns[ i ]... );
+    }
+
+    archetype_rows _rows[ sizeof...(AA) ];
+
+    std::vector< slot > _slots;
+    std::vector< std::uint32_t > _free;
+  };
+
+}
+
+
+//import into global namespace
+
+using luple_ns::entity_store;
+
+#endif // LUPLE_ARCHETYPE_H
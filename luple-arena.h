@@ -0,0 +1,248 @@
+/*
+
+luple-arena: a monotonic arena for batches of luple records (C++14)
+
+License: Public-domain software
+
+Description:
+
+  arena hands out memory by bumping a pointer inside large blocks and never frees single
+  allocations: release() drops a whole batch of records at once and keeps the largest block
+  for the next batch, so a steady request-scoped workload stops touching the global heap.
+
+  arena_allocator< T > is a standard allocator on top of an arena, deallocate does nothing.
+  It converts from arena *, so &arena can be passed to uses-allocator construction of a
+  luple (see luple.h) and reaches every member that uses an arena_allocator. In C++17 the
+  arena is also a std::pmr::memory_resource, and the same &arena reaches std::pmr members.
+
+  Destructors of the records are not called by release(): destroy the records first (or
+  only keep types whose destructor just frees memory, like strings and vectors, whose
+  deallocation is a no-op here). One arena is not thread safe, use one per thread/request.
+
+Dependencies:
+
+  luple.h: uses-allocator construction of luples
+  memory_resource: std::pmr::memory_resource (C++17, if available)
+  new, cstddef, cstdint, memory, algorithm
+
+Usage:
+
+  #include <scoped_allocator>
+  #include "luple-arena.h"
+
+  template<typename T> using arena_vector = std::vector< T, arena_allocator< T > >;
+  using arena_string = std::basic_string< char, std::char_traits< char >, arena_allocator< char > >;
+
+  using record_t = luple< arena_string, int, arena_vector< int > >;
+
+  //a plain allocator doesn't reach the members of the elements, scoped_allocator_adaptor does
+  template<typename T> using scoped_vector = std::vector< T, std::scoped_allocator_adaptor< arena_allocator< T > > >;
+
+  arena a;
+
+  for( auto & request : requests ) {
+
+    {
+      scoped_vector< record_t > batch( &a ); //records and their members are in the arena
+
+      batch.emplace_back( "a long string that goes to the arena", 1, std::initializer_list< int >{ 1, 2, 3 } );
+
+      record_t r{ std::allocator_arg, &a, "no heap allocations", 2, std::initializer_list< int >{ 1, 2 } };
+      ...
+    }
+
+    a.release(); //the whole batch at once
+  }
+
+  //C++17: std::pmr
+  using pmr_record_t = luple< std::pmr::string, std::pmr::vector< int > >;
+
+  std::pmr::vector< pmr_record_t > batch( &a );
+
+*/
+
+#ifndef LUPLE_ARENA_H
+#define LUPLE_ARENA_H
+
+#include <new>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <algorithm>
+
+#if __cplusplus >= 201703L && defined( __has_include )
+  #if __has_include( <memory_resource> )
+    #include <memory_resource>
+    #define LUPLE_ARENA_PMR
+  #endif
+#endif
+
+#include "luple.h"
+
+
+namespace luple_ns {
+
+
+  //the first block, later blocks double in size
+
+  #ifndef LUPLE_ARENA_BLOCK
+    #define LUPLE_ARENA_BLOCK 65536
+  #endif
+
+  #ifdef LUPLE_ARENA_PMR
+    using arena_base = std::pmr::memory_resource;
+  #else
+    struct arena_base {};
+  #endif
+
+
+  struct arena : arena_base {
+
+    explicit arena ( std::size_t block = LUPLE_ARENA_BLOCK ) : _next_size{ block } {}
+
+    ~arena () { free_( _blocks ); }
+
+    arena ( arena const & ) = delete;
+    arena & operator= ( arena const & ) = delete;
+
+    void * allocate ( std::size_t size, std::size_t align = alignof( std::max_align_t ) ) {
+
+      std::size_t pad = _blocks ? pad_( align ) : 0;
+
+      if( ! _blocks || _cursor + pad + size > _blocks->size ) {
+
+        //room for the padding whatever the alignment of the block
+        add_block_( size + align - 1 );
+
+        pad = pad_( align );
+      }
+
+      void * p = _blocks->data() + _cursor + pad;
+
+      _cursor += pad + size;
+      _used += size;
+
+      return p;
+    }
+
+    //frees everything at once, the largest block is kept for reuse
+    void release () {
+
+      if( ! _blocks ) return;
+
+      free_( _blocks->next );
+
+      _blocks->next = nullptr;
+
+      _cursor = 0;
+      _used = 0;
+    }
+
+    //bytes handed out since the last release
+    std::size_t used () const { return _used; }
+
+    //bytes held in blocks
+    std::size_t reserved () const {
+
+      std::size_t r = 0;
+
+      for( block * b = _blocks; b; b = b->next ) r += b->size;
+
+      return r;
+    }
+
+  private:
+
+    struct alignas( std::max_align_t ) block {
+
+      block * next;
+      std::size_t size;
+
+      char * data () { return reinterpret_cast< char * >( this + 1 ); }
+    };
+
+    //padding from the current position to the next address aligned to align
+    std::size_t pad_ ( std::size_t align ) const {
+
+      std::uintptr_t p = reinterpret_cast< std::uintptr_t >( _blocks->data() + _cursor );
+
+      return ( align - p % align ) % align;
+    }
+
+    //a new block becomes the current one, it's the largest so release() keeps it
+    void add_block_ ( std::size_t min_size ) {
+
+      std::size_t size = std::max( _next_size, min_size );
+
+      block * b = static_cast< block * >( ::operator new( sizeof( block ) + size ) );
+
+      b->next = _blocks;
+      b->size = size;
+
+      _blocks = b;
+      _cursor = 0;
+      _next_size = size * 2;
+    }
+
+    static void free_ ( block * b ) {
+
+      while( b ) {
+
+        block * next = b->next;
+
+        ::operator delete( b );
+
+        b = next;
+      }
+    }
+
+  #ifdef LUPLE_ARENA_PMR
+
+    void * do_allocate ( std::size_t size, std::size_t align ) override { return allocate( size, align ); }
+
+    void do_deallocate ( void *, std::size_t, std::size_t ) override {}
+
+    bool do_is_equal ( std::pmr::memory_resource const & o ) const noexcept override { return this == &o; }
+
+  #endif
+
+    block * _blocks = nullptr;
+    std::size_t _cursor = 0;
+    std::size_t _used = 0;
+    std::size_t _next_size;
+  };
+
+
+  //standard allocator on top of an arena, memory is returned by arena::release()
+
+  template<typename T> struct arena_allocator {
+
+    using value_type = T;
+
+    arena_allocator ( arena * a ) noexcept : _arena{ a } {}
+
+    template<typename U>
+    arena_allocator ( arena_allocator<U> const & o ) noexcept : _arena{ o._arena } {}
+
+    T * allocate ( std::size_t n ) { return static_cast< T * >( _arena->allocate( n * sizeof( T ), alignof( T ) ) ); }
+
+    void deallocate ( T *, std::size_t ) noexcept {}
+
+    arena * _arena;
+  };
+
+  template<typename T, typename U>
+  bool operator == ( arena_allocator<T> const & a, arena_allocator<U> const & b ) { return a._arena == b._arena; }
+
+  template<typename T, typename U>
+  bool operator != ( arena_allocator<T> const & a, arena_allocator<U> const & b ) { return a._arena != b._arena; }
+
+}
+
+
+//import into global namespace
+
+using luple_ns::arena;
+using luple_ns::arena_allocator;
+
+#endif // LUPLE_ARENA_H
@@ -0,0 +1,348 @@
+/*
+
+luple-bits: a bit-packed luple (C++14)
+
+License: Public-domain software
+
+Description:
+
+  bit_luple< bits<3>, bits<1>, bits<12>, ... > stores members with declared bit widths packed
+  into as few words as possible. The word type is the smallest unsigned type that fits all
+  bits (up to 64), above that it's an array of 64-bit words. A member never straddles a word
+  boundary, it goes to the first word with enough free bits (first fit), so a small member
+  can fill a gap left in an earlier word.
+
+  bits< N > reads as the smallest unsigned type with N bits (bool for 1 bit), bits< N, T >
+  reads as T: an enum, bool or a signed type (sign-extended). Values are truncated to N bits
+  on write.
+
+  get< N > returns a proxy that converts to the member type and can be assigned to,
+  on a const bit_luple it returns the value. Construction is constexpr.
+
+  bit_unpack and bit_pack convert between an array of bit_luples and one array per member
+  (columns). Each column is a separate loop of shifts and masks over the array that
+  compilers vectorize.
+
+Dependencies:
+
+  luple.h: luple_ns namespace, type_list
+  type_traits: std::conditional_t, std::is_signed, std::is_enum, std::underlying_type
+  cstdint: std::uint8_t ... std::uint64_t
+  cstddef: std::size_t
+
+Usage:
+
+  #include "luple-bits.h"
+
+  enum class level : std::uint8_t { debug, info, warning, error };
+
+  using event_t = bit_luple< bits< 2, level >, bits< 1 >, bits< 12 >, bits< 5, int > >;
+
+  static_assert( sizeof( event_t ) == 4, "" ); // 20 bits in a 32-bit word
+
+  constexpr event_t e{ level::warning, true, 1000, -3 };
+
+  static_assert( get< 2 >( e ) == 1000, "" );
+
+  event_t e1 = e;
+
+  get< 2 >( e1 ) = 1001;
+  get< 3 >( e1 ) = get< 3 >( e1 ) - 1;
+
+  //arrays
+
+  event_t events[ 1024 ];
+  level levels[ 1024 ]; bool flags[ 1024 ]; std::uint16_t counts[ 1024 ]; int deltas[ 1024 ];
+
+  bit_unpack( events, 1024, levels, flags, counts, deltas );
+  bit_pack( events, 1024, levels, flags, counts, deltas );
+
+*/
+
+#ifndef LUPLE_BITS_H
+#define LUPLE_BITS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+#include "luple.h"
+
+
+namespace luple_ns {
+
+
+  //default member type for a bit width
+
+  template<int N>
+  using bits_type_t =
+    std::conditional_t< N == 1, bool,
+    std::conditional_t< N <= 8, std::uint8_t,
+    std::conditional_t< N <= 16, std::uint16_t,
+    std::conditional_t< N <= 32, std::uint32_t, std::uint64_t > > > >;
+
+
+  //member declaration: width and type
+
+  template<int N, typename T = bits_type_t<N>>
+  struct bits {
+
+    static_assert( N > 0 && N <= 64, "bit width should be in [1, 64]" );
+    static_assert( sizeof( T ) * 8 >= N, "the type is too small for the bit width" );
+
+    static const int width = N;
+
+    using type = T;
+  };
+
+
+  //word type and layout: members are placed in order and don't straddle words
+
+  template<int... NN>
+  constexpr int bits_total () {
+
+    int const widths[] = { NN..., 0 };
+    int total = 0;
+
+    for( int w : widths ) total += w;
+
+    return total;
+  }
+
+  template<int... NN>
+  struct bits_layout {
+
+    static const int total = bits_total< NN... >();
+
+    using word_t =
+      std::conditional_t< total <= 8, std::uint8_t,
+      std::conditional_t< total <= 16, std::uint16_t,
+      std::conditional_t< total <= 32, std::uint32_t, std::uint64_t > > >;
+
+    static const int word_bits = sizeof( word_t ) * 8;
+
+    //bit position of member n counting from the start of the first word,
+    //first fit: a member goes to the first word with enough free bits
+    static constexpr int position ( int n ) {
+
+      int const widths[] = { NN... };
+      int used[ sizeof...(NN) ] = {};
+
+      for( int i = 0; ; ++i ) {
+
+        int w = 0;
+
+        while( used[w] + widths[i] > word_bits ) ++w;
+
+        if( i == n ) return w * word_bits + used[w];
+
+        used[w] += widths[i];
+      }
+    }
+
+    static constexpr int words () {
+
+      int n = 0;
+
+      for( int i = 0; i < int( sizeof...(NN) ); ++i )
+
+        if( position( i ) / word_bits + 1 > n ) n = position( i ) / word_bits + 1;
+
+      return n;
+    }
+  };
+
+
+  //T - type_list< bits<...>... >
+
+  template<typename T> struct bit_luple_t;
+
+  template<typename... BB> struct bit_luple_t< type_list<BB...> > {
+
+    static_assert( sizeof...(BB) > 0, "empty bit_luple" );
+
+    using layout = bits_layout< BB::width... >;
+    using word_t = typename layout::word_t;
+
+    using type_list = luple_ns::type_list< typename BB::type... >;
+
+    static const int size = sizeof...(BB);
+    static const int words = layout::words();
+
+    template<int N>
+    using member_t = tlist_get_t< type_list, N >;
+
+    template<int N>
+    static constexpr int width () { return tlist_get_t< luple_ns::type_list<BB...>, N >::width; }
+
+    template<int N>
+    static constexpr int word () { return layout::position( N ) / layout::word_bits; }
+
+    template<int N>
+    static constexpr int shift () { return layout::position( N ) % layout::word_bits; }
+
+    template<int N>
+    static constexpr word_t mask () { return width<N>() == 64 ? ~word_t{} : word_t( ( std::uint64_t{ 1 } << width<N>() ) - 1 ); }
+
+
+    constexpr bit_luple_t () : _w{} {}
+
+    constexpr bit_luple_t ( typename BB::type... args ) : _w{} {
+
+      init_( std::make_integer_sequence< int, size >{}, args... );
+    }
+
+
+    //read a member
+
+    template<int N>
+    constexpr member_t<N> get () const {
+
+      using U = member_t<N>;
+      using I = std::conditional_t< std::is_enum<U>::value, std::underlying_type< U >, std::common_type< U > >;
+      using V = typename I::type;
+
+      word_t raw = ( _w[ word<N>() ] >> shift<N>() ) & mask<N>();
+
+      //sign extension
+      if( std::is_signed<V>::value && width<N>() < 64 && ( raw >> ( width<N>() - 1 ) & 1 ) )
+
+        return U( V( std::uint64_t( raw ) | ~( ( std::uint64_t{ 1 } << width<N>() ) - 1 ) ) );
+
+      return U( V( raw ) );
+    }
+
+
+    //write a member, truncated to its width
+
+    template<int N>
+    constexpr void set ( member_t<N> v ) {
+
+      word_t raw = word_t( std::uint64_t( v ) ) & mask<N>();
+
+      _w[ word<N>() ] = word_t( ( _w[ word<N>() ] & ~word_t( mask<N>() << shift<N>() ) ) | word_t( raw << shift<N>() ) );
+    }
+
+
+    //proxy returned by get< N >( bit_luple & )
+
+    template<int N>
+    struct reference {
+
+      constexpr operator member_t<N> () const { return _l.template get<N>(); }
+
+      constexpr reference & operator= ( member_t<N> v ) { _l.template set<N>( v ); return *this; }
+
+      constexpr reference & operator= ( reference const & r ) { return *this = member_t<N>( r ); }
+
+      bit_luple_t & _l;
+    };
+
+
+    word_t _w[ words ];
+
+  private:
+
+    template<int... NN, typename... UU>
+    constexpr void init_ ( std::integer_sequence<int, NN...>, UU... args ) {
+
+      char dummy[] = { ( set<NN>( args ), char{} )... };
+      (void) dummy;
+    }
+  };
+
+
+  template<typename... BB>
+  using bit_luple = bit_luple_t< type_list< BB... > >;
+
+
+  //get helpers
+
+  template<int N, typename T>
+  constexpr auto get ( bit_luple_t<T> & l ) { return typename bit_luple_t<T>::template reference<N>{ l }; }
+
+  template<int N, typename T>
+  constexpr auto get ( bit_luple_t<T> const & l ) { return l.template get<N>(); }
+
+  template<typename T>
+  constexpr auto size ( bit_luple_t<T> const & ) { return bit_luple_t<T>::size; }
+
+
+  template<typename T>
+  constexpr bool operator == ( bit_luple_t<T> const & a, bit_luple_t<T> const & b ) {
+
+    for( int i = 0; i < bit_luple_t<T>::words; ++i ) if( a._w[i] != b._w[i] ) return false;
+
+    return true;
+  }
+
+  template<typename T>
+  constexpr bool operator != ( bit_luple_t<T> const & a, bit_luple_t<T> const & b ) { return !( a == b ); }
+
+
+  //array of bit_luples -> one array per member
+
+  template<int N, typename T, typename U>
+  void bit_unpack_column ( bit_luple_t<T> const * in, std::size_t n, U * out ) {
+
+    for( std::size_t i = 0; i < n; ++i ) out[i] = in[i].template get<N>();
+  }
+
+  template<typename T, int... NN, typename... UU>
+  void bit_unpack_ ( bit_luple_t<T> const * in, std::size_t n, std::integer_sequence<int, NN...>, UU *... out ) {
+
+    char dummy[] = { ( bit_unpack_column<NN>( in, n, out ), char{} )... };
+    (void) dummy;
+  }
+
+  template<typename T, typename... UU>
+  void bit_unpack ( bit_luple_t<T> const * in, std::size_t n, UU *... columns ) {
+
+    static_assert( sizeof...(UU) == bit_luple_t<T>::size, "a column for every member" );
+
+    bit_unpack_( in, n, std::make_integer_sequence< int, sizeof...(UU) >{}, columns... );
+  }
+
+
+  //one array per member -> array of bit_luples
+
+  template<int N, typename T, typename U>
+  void bit_pack_column ( bit_luple_t<T> * out, std::size_t n, U const * in ) {
+
+    using L = bit_luple_t<T>;
+    using word_t = typename L::word_t;
+
+    for( std::size_t i = 0; i < n; ++i )
+
+      out[i]._w[ L::template word<N>() ] |= word_t( ( word_t( std::uint64_t( in[i] ) ) & L::template mask<N>() ) << L::template shift<N>() );
+  }
+
+  template<typename T, int... NN, typename... UU>
+  void bit_pack_ ( bit_luple_t<T> * out, std::size_t n, std::integer_sequence<int, NN...>, UU const *... in ) {
+
+    char dummy[] = { ( bit_pack_column<NN>( out, n, in ), char{} )... };
+    (void) dummy;
+  }
+
+  template<typename T, typename... UU>
+  void bit_pack ( bit_luple_t<T> * out, std::size_t n, UU const *... columns ) {
+
+    static_assert( sizeof...(UU) == bit_luple_t<T>::size, "a column for every member" );
+
+    for( std::size_t i = 0; i < n; ++i ) out[i] = bit_luple_t<T>{};
+
+    bit_pack_( out, n, std::make_integer_sequence< int, sizeof...(UU) >{}, columns... );
+  }
+
+}
+
+
+//import into global namespace
+
+using luple_ns::bits;
+using luple_ns::bit_luple;
+using luple_ns::bit_luple_t;
+using luple_ns::bit_pack;
+using luple_ns::bit_unpack;
+
+#endif // LUPLE_BITS_H
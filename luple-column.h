@@ -0,0 +1,873 @@
+/*
+
+luple-column: compressed column storage for luple and nuple rows (C++14)
+
+License: Public-domain software
+
+Description:
+
+  column_store< R > (R is a luple_t< type_list<...> > or a nuple) keeps rows as one compressed
+  column per member. The encoding follows the member type:
+
+    integral, bool, enum  - frame of reference, delta or run-length, chosen per block
+    floating point        - plain values, with a min/max per block
+    anything else         - dictionary (std::hash, ==), the codes are an integral column
+
+  Integral columns are split into blocks of LUPLE_COLUMN_BLOCK values. For every block the
+  smallest of these is kept:
+
+    frame of reference - the block minimum and (value - minimum) in the fewest bits
+    delta              - the first value, the smallest step and (step - smallest) in the
+                         fewest bits, plus every 32nd value so at( i ) adds at most 31
+                         steps; for sorted data like timestamps
+    run-length         - (value, end of run) pairs; for long runs of equal values
+    raw                - 64 bits per value when nothing else fits in 32 bits
+
+  Bits are packed in groups of 128 values, 4 interleaved lanes of 32 values, so unpacking is
+  the same shift and mask on 4 lanes at once: one SSE2 register (scalar code without SSE2 or
+  with LUPLE_NO_SIMD, see luple-math.h).
+
+  filter< N >( lo, hi ) returns the ids of rows with lo <= value <= hi without decoding whole
+  rows: blocks outside the range are skipped by their min/max, blocks inside it are taken
+  whole, frame of reference blocks are compared on the packed offsets, run-length blocks per
+  run. filter< N >( pred ) on a dictionary column calls pred once per distinct value and then
+  checks the codes. scan< N >( f ) decodes a column block by block.
+
+  stats< N >() reports the encodings, the size and the compression ratio of a column. Raw
+  size is sizeof( T ) per value, memory that members own (string characters) is not counted.
+
+  The store is built once from an array of rows and is read-only. Row ids are 32-bit.
+
+Dependencies:
+
+  luple.h: luple, type_list, get
+  luple-math.h: LUPLE_SSE (SIMD switch)
+  vector, unordered_map, functional, algorithm, cstdint, cstddef, type_traits
+
+Usage:
+
+  #include "luple-column.h"
+
+  using trade_t = nuple< $("ts"), std::int64_t, $("sym"), std::string, $("qty"), int, $("px"), double >;
+
+  std::vector< trade_t > trades{ ... };
+
+  column_store< trade_t > store{ trades };
+
+  //row ids
+  auto big = store.filter< $("qty") >( 1000, 1000000 ); //or filter< 2 >( ... ) with luples
+  auto ibm = store.filter< $("sym") >( []( std::string const & s ) { return s == "IBM"; } );
+  auto day = store.filter< $("ts") >( t0, t1 );
+
+  double px = store.at< $("px") >( big[ 0 ] );
+  trade_t t = store.row( ibm[ 0 ] );
+
+  double volume = 0;
+  store.scan< $("qty") >( [&]( std::size_t row, int qty ) { volume += qty; } );
+
+  auto s = store.stats< $("sym") >(); //s.ratio(), s.bytes, s.raw_bytes, s.blocks[ column_for ]
+
+  //bench/column-bench.cpp compares filters and scans with a std::vector of rows
+
+*/
+
+#ifndef LUPLE_COLUMN_H
+#define LUPLE_COLUMN_H
+
+#include <vector>
+#include <unordered_map>
+#include <functional>
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+#include <type_traits>
+
+#include "luple.h"
+#include "luple-math.h"
+
+
+namespace luple_ns {
+
+
+  //values per block of an integral column, a multiple of 128
+
+  #ifndef LUPLE_COLUMN_BLOCK
+    #define LUPLE_COLUMN_BLOCK 1024
+  #endif
+
+  static_assert( LUPLE_COLUMN_BLOCK % 128 == 0, "LUPLE_COLUMN_BLOCK should be a multiple of 128" );
+
+  const std::size_t column_block_size = LUPLE_COLUMN_BLOCK;
+
+  //values between checkpoints of a delta block
+  const std::size_t column_checkpoint = 32;
+
+
+  //encodings of integral blocks
+
+  enum column_encoding { column_raw, column_for, column_delta, column_rle };
+
+
+  struct column_stats {
+
+    std::size_t raw_bytes;
+    std::size_t bytes;
+
+    //blocks by column_encoding (integral and dictionary code columns)
+    std::size_t blocks[ 4 ];
+
+    //distinct values of a dictionary column, 0 for others
+    std::size_t dictionary;
+
+    double ratio () const { return bytes ? double( raw_bytes ) / bytes : 0; }
+  };
+
+
+  //bit packing: 128 values in 4 interleaved lanes, value k * 4 + l is the k-th value of lane l,
+  //word w of lane l is at w * 4 + l
+
+  inline void column_pack ( std::uint32_t const * in, int bits, std::uint32_t * out ) {
+
+    if( ! bits ) return;
+
+    for( int i = 0; i < 4 * bits; ++i ) out[ i ] = 0;
+
+    for( int k = 0; k < 32; ++k ) {
+
+      int bit = k * bits, w = bit >> 5, s = bit & 31;
+
+      for( int l = 0; l < 4; ++l ) {
+
+        out[ w * 4 + l ] |= in[ k * 4 + l ] << s;
+
+        if( s + bits > 32 ) out[ ( w + 1 ) * 4 + l ] |= in[ k * 4 + l ] >> ( 32 - s );
+      }
+    }
+  }
+
+  template<int B>
+  void column_unpack_ ( std::uint32_t const * in, std::uint32_t * out ) {
+
+    if( B == 0 ) { for( int i = 0; i < 128; ++i ) out[ i ] = 0; return; }
+
+    const std::uint32_t mask = std::uint32_t( ( std::uint64_t{ 1 } << B ) - 1 );
+
+    for( int k = 0; k < 32; ++k ) {
+
+      const int bit = k * B, w = bit >> 5, s = bit & 31;
+
+#ifdef LUPLE_SSE
+      __m128i v = _mm_srli_epi32( _mm_loadu_si128( reinterpret_cast< __m128i const * >( in + w * 4 ) ), s );
+
+      if( s + B > 32 ) v = _mm_or_si128( v, _mm_slli_epi32( _mm_loadu_si128( reinterpret_cast< __m128i const * >( in + ( w + 1 ) * 4 ) ), 32 - s ) );
+
+      _mm_storeu_si128( reinterpret_cast< __m128i * >( out + k * 4 ), _mm_and_si128( v, _mm_set1_epi32( int( mask ) ) ) );
+#else
+      for( int l = 0; l < 4; ++l ) {
+
+        std::uint32_t v = in[ w * 4 + l ] >> s;
+
+        if( s + B > 32 ) v |= in[ ( w + 1 ) * 4 + l ] << ( ( 32 - s ) & 31 );
+
+        out[ k * 4 + l ] = v & mask;
+      }
+#endif
+    }
+  }
+
+  template<int... BB>
+  void column_unpack_n ( int bits, std::uint32_t const * in, std::uint32_t * out, std::integer_sequence<int, BB...> ) {
+
+    using unpack_t = void (*)( std::uint32_t const *, std::uint32_t * );
+
+    static unpack_t const unpack[] = { &column_unpack_<BB>... };
+
+    unpack[ bits ]( in, out );
+  }
+
+  //128 values of bits width
+  inline void column_unpack ( int bits, std::uint32_t const * in, std::uint32_t * out ) {
+
+    column_unpack_n( bits, in, out, std::make_integer_sequence< int, 33 >{} );
+  }
+
+  inline int column_bits ( std::uint64_t range ) {
+
+    int bits = 0;
+
+    while( bits < 64 && ( range >> bits ) ) ++bits;
+
+    return bits;
+  }
+
+
+  //a column of 64-bit keys, compressed in blocks
+
+  struct column_block {
+
+    std::uint64_t min, max;
+    std::uint64_t base; //for: minimum, delta: first value
+    std::uint64_t step; //delta: smallest step, rle: number of runs
+    std::size_t offset; //first word, delta: checkpoints follow the packed words
+    std::uint32_t size;
+    std::uint8_t encoding, bits;
+  };
+
+  struct packed_column {
+
+    void append ( std::uint64_t const * keys, std::size_t n ) {
+
+      for( std::size_t b = 0; b < n; b += column_block_size ) add_block_( keys + b, std::min( column_block_size, n - b ) );
+
+      _size += n;
+    }
+
+    std::size_t size () const { return _size; }
+
+    std::size_t bytes () const { return _words.size() * sizeof( std::uint32_t ) + _blocks.size() * sizeof( column_block ); }
+
+    void count ( std::size_t * blocks ) const { for( auto const & b : _blocks ) blocks[ b.encoding ]++; }
+
+    std::size_t blocks () const { return _blocks.size(); }
+
+    //all keys of block b
+    void decode ( std::size_t b, std::uint64_t * out ) const {
+
+      column_block const & k = _blocks[ b ];
+      std::uint32_t const * w = _words.data() + k.offset;
+      std::uint32_t buf[ 128 ];
+
+      switch( k.encoding ) {
+
+        case column_for:
+
+          for( std::size_t g = 0; g < k.size; g += 128 ) {
+
+            column_unpack( k.bits, w + g / 128 * 4 * k.bits, buf );
+
+            for( std::size_t i = 0, n = std::min< std::size_t >( 128, k.size - g ); i < n; ++i ) out[ g + i ] = k.base + buf[ i ];
+          }
+
+          break;
+
+        case column_delta: {
+
+          std::uint64_t v = k.base;
+
+          for( std::size_t g = 0; g < k.size; g += 128 ) {
+
+            column_unpack( k.bits, w + g / 128 * 4 * k.bits, buf );
+
+            for( std::size_t i = 0, n = std::min< std::size_t >( 128, k.size - g ); i < n; ++i ) {
+
+              if( g + i ) v += k.step + buf[ i ];
+
+              out[ g + i ] = v;
+            }
+          }
+
+          break;
+        }
+
+        case column_rle:
+
+          for( std::size_t r = 0, i = 0; r < k.step; ++r ) {
+
+            std::uint64_t v = w[ r * 2 ] | std::uint64_t( w[ r * 2 + 1 ] ) << 32;
+
+            for( std::uint32_t end = w[ k.step * 2 + r ]; i < end; ++i ) out[ i ] = v;
+          }
+
+          break;
+
+        default:
+
+          for( std::size_t i = 0; i < k.size; ++i ) out[ i ] = w[ i * 2 ] | std::uint64_t( w[ i * 2 + 1 ] ) << 32;
+      }
+    }
+
+    std::uint64_t at ( std::size_t i ) const {
+
+      column_block const & k = _blocks[ i / column_block_size ];
+      std::uint32_t const * w = _words.data() + k.offset;
+
+      i %= column_block_size;
+
+      switch( k.encoding ) {
+
+        case column_for:
+
+          return k.base + unpack_one_( w, k.bits, i );
+
+        case column_delta: {
+
+          //from the checkpoint before i
+          std::size_t c = i / column_checkpoint;
+          std::uint32_t const * p = w + ( k.size + 127 ) / 128 * 4 * k.bits + c * 2;
+
+          std::uint64_t v = p[ 0 ] | std::uint64_t( p[ 1 ] ) << 32;
+
+          for( std::size_t j = c * column_checkpoint + 1; j <= i; ++j ) v += k.step + unpack_one_( w, k.bits, j );
+
+          return v;
+        }
+
+        case column_rle: {
+
+          std::uint32_t const * ends = w + k.step * 2;
+
+          std::size_t r = std::upper_bound( ends, ends + k.step, std::uint32_t( i ) ) - ends;
+
+          return w[ r * 2 ] | std::uint64_t( w[ r * 2 + 1 ] ) << 32;
+        }
+
+        default:
+
+          return w[ i * 2 ] | std::uint64_t( w[ i * 2 + 1 ] ) << 32;
+      }
+    }
+
+    //ids of rows with lo <= key <= hi
+    void filter ( std::uint64_t lo, std::uint64_t hi, std::vector< std::uint32_t > & rows ) const {
+
+      std::uint64_t keys[ column_block_size ];
+      std::uint32_t buf[ 128 ];
+
+      for( std::size_t b = 0; b < _blocks.size(); ++b ) {
+
+        column_block const & k = _blocks[ b ];
+        std::uint32_t const * w = _words.data() + k.offset;
+        std::uint32_t first = std::uint32_t( b * column_block_size );
+
+        if( hi < k.min || k.max < lo ) continue;
+
+        std::size_t n = rows.size();
+
+        if( lo <= k.min && k.max <= hi ) {
+
+          rows.resize( n + k.size );
+
+          for( std::uint32_t i = 0; i < k.size; ++i ) rows[ n + i ] = first + i;
+
+          continue;
+        }
+
+        //room for the whole block, trimmed below
+        rows.resize( n + k.size );
+
+        if( k.encoding == column_for ) {
+
+          //compared on the offsets: lo - base <= offset <= hi - base
+          std::uint32_t from = std::uint32_t( lo > k.base ? lo - k.base : 0 );
+          std::uint32_t span = std::uint32_t( std::min( hi, k.max ) - k.base ) - from;
+
+          for( std::uint32_t g = 0; g < k.size; g += 128 ) {
+
+            column_unpack( k.bits, w + g / 128 * 4 * k.bits, buf );
+
+            for( std::uint32_t i = 0, e = std::min< std::uint32_t >( 128, k.size - g ); i < e; ++i ) {
+
+              rows[ n ] = first + g + i;
+              n += buf[ i ] - from <= span;
+            }
+          }
+        }
+
+        else if( k.encoding == column_rle ) {
+
+          for( std::uint32_t r = 0, i = 0; r < k.step; ++r ) {
+
+            std::uint64_t v = w[ r * 2 ] | std::uint64_t( w[ r * 2 + 1 ] ) << 32;
+            std::uint32_t end = w[ k.step * 2 + r ];
+
+            if( lo <= v && v <= hi ) for( ; i < end; ++i ) rows[ n++ ] = first + i;
+
+            i = end;
+          }
+        }
+
+        else {
+
+          decode( b, keys );
+
+          for( std::uint32_t i = 0; i < k.size; ++i ) {
+
+            rows[ n ] = first + i;
+            n += lo <= keys[ i ] && keys[ i ] <= hi;
+          }
+        }
+
+        rows.resize( n );
+      }
+    }
+
+  private:
+
+    //i-th packed value of a block
+    static std::uint64_t unpack_one_ ( std::uint32_t const * w, int bits, std::size_t i ) {
+
+      if( ! bits ) return 0;
+
+      std::size_t j = i % 128, s = j / 4 * bits;
+
+      w += i / 128 * 4 * bits + s / 32 * 4 + j % 4;
+      s %= 32;
+
+      std::uint64_t v = w[ 0 ] >> s;
+
+      if( s + bits > 32 ) v |= std::uint64_t( w[ 4 ] ) << ( 32 - s );
+
+      return v & ( ( std::uint64_t{ 1 } << bits ) - 1 );
+    }
+
+    void add_block_ ( std::uint64_t const * keys, std::size_t n ) {
+
+      column_block k{};
+
+      k.size = std::uint32_t( n );
+      k.offset = _words.size();
+      k.min = *std::min_element( keys, keys + n );
+      k.max = *std::max_element( keys, keys + n );
+
+      //steps as signed values, any step works modulo 2^64
+      std::int64_t dmin = 0, dmax = 0;
+      std::size_t runs = 1;
+
+      for( std::size_t i = 1; i < n; ++i ) {
+
+        std::int64_t d = std::int64_t( keys[ i ] - keys[ i - 1 ] );
+
+        if( i == 1 || d < dmin ) dmin = d;
+        if( i == 1 || d > dmax ) dmax = d;
+
+        runs += keys[ i ] != keys[ i - 1 ];
+      }
+
+      int for_bits = column_bits( k.max - k.min );
+      int delta_bits = column_bits( std::uint64_t( dmax ) - std::uint64_t( dmin ) );
+
+      std::size_t groups = ( n + 127 ) / 128, checkpoints = ( n + column_checkpoint - 1 ) / column_checkpoint, none = std::size_t( -1 );
+
+      std::size_t sizes[ 4 ] = {
+        n * 2,
+        for_bits <= 32 ? groups * 4 * for_bits : none,
+        delta_bits <= 32 ? groups * 4 * delta_bits + checkpoints * 2 : none,
+        runs * 3 };
+
+      //ties go to the faster encoding: for, delta, rle, raw
+      int order[] = { column_for, column_delta, column_rle, column_raw };
+      int e = column_for;
+
+      for( int o : order ) if( sizes[ o ] < sizes[ e ] ) e = o;
+
+      k.encoding = std::uint8_t( e );
+
+      _words.resize( k.offset + sizes[ e ] );
+
+      std::uint32_t * w = _words.data() + k.offset;
+
+      if( e == column_for || e == column_delta ) {
+
+        k.bits = std::uint8_t( e == column_for ? for_bits : delta_bits );
+        k.base = e == column_for ? k.min : keys[ 0 ];
+        k.step = e == column_for ? 0 : std::uint64_t( dmin );
+
+        std::uint32_t buf[ 128 ];
+
+        for( std::size_t g = 0; g < n; g += 128 ) {
+
+          for( std::size_t i = 0; i < 128; ++i ) {
+
+            std::size_t j = g + i;
+
+            buf[ i ] = j >= n ? 0 : e == column_for ? std::uint32_t( keys[ j ] - k.base ) : j ? std::uint32_t( keys[ j ] - keys[ j - 1 ] - k.step ) : 0;
+          }
+
+          column_pack( buf, k.bits, w + g / 128 * 4 * k.bits );
+        }
+
+        if( e == column_delta ) for( std::size_t c = 0; c < checkpoints; ++c ) {
+
+          std::uint32_t * p = w + groups * 4 * k.bits + c * 2;
+
+          p[ 0 ] = std::uint32_t( keys[ c * column_checkpoint ] );
+          p[ 1 ] = std::uint32_t( keys[ c * column_checkpoint ] >> 32 );
+        }
+      }
+
+      else if( e == column_rle ) {
+
+        k.step = runs;
+
+        for( std::size_t i = 0, r = 0; i < n; ++i ) {
+
+          if( i + 1 < n && keys[ i + 1 ] == keys[ i ] ) continue;
+
+          w[ r * 2 ] = std::uint32_t( keys[ i ] );
+          w[ r * 2 + 1 ] = std::uint32_t( keys[ i ] >> 32 );
+          w[ runs * 2 + r ] = std::uint32_t( i + 1 );
+
+          ++r;
+        }
+      }
+
+      else for( std::size_t i = 0; i < n; ++i ) {
+
+        w[ i * 2 ] = std::uint32_t( keys[ i ] );
+        w[ i * 2 + 1 ] = std::uint32_t( keys[ i ] >> 32 );
+      }
+
+      _blocks.push_back( k );
+    }
+
+    std::vector< column_block > _blocks;
+    std::vector< std::uint32_t > _words;
+    std::size_t _size = 0;
+  };
+
+
+  //order preserving mapping of integral values to 64-bit keys
+
+  template<typename T, bool = std::is_enum<T>::value> struct column_key {
+
+    using type = T;
+  };
+
+  template<typename T> struct column_key< T, true > {
+
+    using type = std::underlying_type_t<T>;
+  };
+
+  template<typename T>
+  constexpr std::uint64_t column_to_key ( T v ) {
+
+    using U = typename column_key<T>::type;
+
+    return std::is_signed<U>::value ? std::uint64_t( std::int64_t( U( v ) ) ) ^ ( std::uint64_t{ 1 } << 63 ) : std::uint64_t( U( v ) );
+  }
+
+  template<typename T>
+  constexpr T column_from_key ( std::uint64_t k ) {
+
+    using U = typename column_key<T>::type;
+
+    return T( std::is_signed<U>::value ? U( std::int64_t( k ^ ( std::uint64_t{ 1 } << 63 ) ) ) : U( k ) );
+  }
+
+
+  //a column of T: 0 - integral (bool, enum), 1 - floating point, 2 - dictionary
+
+  template<typename T> struct column_kind {
+
+    static const int value = std::is_integral<T>::value || std::is_enum<T>::value ? 0 : std::is_floating_point<T>::value ? 1 : 2;
+  };
+
+  template<typename T, int K = column_kind<T>::value> struct column_codec;
+
+
+  template<typename T> struct column_codec< T, 0 > {
+
+    template<typename F>
+    void build ( std::size_t n, F && value ) {
+
+      std::vector< std::uint64_t > keys( n );
+
+      for( std::size_t i = 0; i < n; ++i ) keys[ i ] = column_to_key< T >( value( i ) );
+
+      _packed.append( keys.data(), n );
+    }
+
+    T at ( std::size_t i ) const { return column_from_key< T >( _packed.at( i ) ); }
+
+    template<typename F>
+    void scan ( F && f ) const {
+
+      std::vector< std::uint64_t > keys( column_block_size );
+
+      for( std::size_t b = 0; b < _packed.blocks(); ++b ) {
+
+        _packed.decode( b, keys.data() );
+
+        std::size_t first = b * column_block_size;
+
+        for( std::size_t i = 0, n = std::min( column_block_size, _packed.size() - first ); i < n; ++i ) f( first + i, column_from_key< T >( keys[ i ] ) );
+      }
+    }
+
+    void filter ( T lo, T hi, std::vector< std::uint32_t > & rows ) const { _packed.filter( column_to_key< T >( lo ), column_to_key< T >( hi ), rows ); }
+
+    template<typename F>
+    void filter ( F && pred, std::vector< std::uint32_t > & rows ) const {
+
+      scan( [&]( std::size_t row, T v ) { if( pred( v ) ) rows.push_back( std::uint32_t( row ) ); } );
+    }
+
+    column_stats stats () const {
+
+      column_stats s{ _packed.size() * sizeof( T ), _packed.bytes(), {}, 0 };
+
+      _packed.count( s.blocks );
+
+      return s;
+    }
+
+    packed_column _packed;
+  };
+
+
+  template<typename T> struct column_codec< T, 1 > {
+
+    template<typename F>
+    void build ( std::size_t n, F && value ) {
+
+      _values.resize( n );
+
+      for( std::size_t i = 0; i < n; ++i ) _values[ i ] = value( i );
+
+      for( std::size_t b = 0; b < n; b += column_block_size ) {
+
+        auto range = std::minmax_element( _values.begin() + b, _values.begin() + std::min( n, b + column_block_size ) );
+
+        _min.push_back( *range.first );
+        _max.push_back( *range.second );
+      }
+    }
+
+    T at ( std::size_t i ) const { return _values[ i ]; }
+
+    template<typename F>
+    void scan ( F && f ) const { for( std::size_t i = 0; i < _values.size(); ++i ) f( i, _values[ i ] ); }
+
+    void filter ( T lo, T hi, std::vector< std::uint32_t > & rows ) const {
+
+      for( std::size_t b = 0; b < _min.size(); ++b ) {
+
+        if( hi < _min[ b ] || _max[ b ] < lo ) continue;
+
+        std::size_t n = rows.size(), end = std::min( _values.size(), ( b + 1 ) * column_block_size );
+
+        rows.resize( n + end - b * column_block_size );
+
+        for( std::size_t i = b * column_block_size; i < end; ++i ) {
+
+          rows[ n ] = std::uint32_t( i );
+          n += lo <= _values[ i ] && _values[ i ] <= hi;
+        }
+
+        rows.resize( n );
+      }
+    }
+
+    template<typename F>
+    void filter ( F && pred, std::vector< std::uint32_t > & rows ) const {
+
+      for( std::size_t i = 0; i < _values.size(); ++i ) if( pred( _values[ i ] ) ) rows.push_back( std::uint32_t( i ) );
+    }
+
+    column_stats stats () const {
+
+      return column_stats{ _values.size() * sizeof( T ), ( _values.size() + _min.size() * 2 ) * sizeof( T ), {}, 0 };
+    }
+
+    std::vector< T > _values;
+    std::vector< T > _min, _max;
+  };
+
+
+  template<typename T> struct column_codec< T, 2 > {
+
+    template<typename F>
+    void build ( std::size_t n, F && value ) {
+
+      std::unordered_map< T, std::uint32_t > codes;
+      std::vector< std::uint64_t > keys( n );
+
+      for( std::size_t i = 0; i < n; ++i ) {
+
+        auto r = codes.emplace( value( i ), std::uint32_t( _dictionary.size() ) );
+
+        if( r.second ) _dictionary.push_back( r.first->first );
+
+        keys[ i ] = r.first->second;
+      }
+
+      _codes.append( keys.data(), n );
+    }
+
+    T const & at ( std::size_t i ) const { return _dictionary[ _codes.at( i ) ]; }
+
+    template<typename F>
+    void scan ( F && f ) const {
+
+      std::vector< std::uint64_t > keys( column_block_size );
+
+      for( std::size_t b = 0; b < _codes.blocks(); ++b ) {
+
+        _codes.decode( b, keys.data() );
+
+        std::size_t first = b * column_block_size;
+
+        for( std::size_t i = 0, n = std::min( column_block_size, _codes.size() - first ); i < n; ++i ) f( first + i, _dictionary[ keys[ i ] ] );
+      }
+    }
+
+    void filter ( T const & lo, T const & hi, std::vector< std::uint32_t > & rows ) const {
+
+      filter( [&]( T const & v ) { return ! ( v < lo ) && ! ( hi < v ); }, rows );
+    }
+
+    //pred once per distinct value, a contiguous range of codes is filtered on the packed codes
+    template<typename F>
+    void filter ( F && pred, std::vector< std::uint32_t > & rows ) const {
+
+      std::vector< char > match( _dictionary.size() );
+      std::size_t count = 0, first = 0, last = 0;
+
+      for( std::size_t c = 0; c < _dictionary.size(); ++c ) {
+
+        if( ! ( match[ c ] = char( pred( _dictionary[ c ] ) ) ) ) continue;
+
+        if( ! count++ ) first = c;
+
+        last = c;
+      }
+
+      if( ! count ) return;
+
+      if( last - first + 1 == count ) { _codes.filter( first, last, rows ); return; }
+
+      std::vector< std::uint64_t > keys( column_block_size );
+
+      for( std::size_t b = 0; b < _codes.blocks(); ++b ) {
+
+        _codes.decode( b, keys.data() );
+
+        std::size_t first_row = b * column_block_size;
+
+        for( std::size_t i = 0, n = std::min( column_block_size, _codes.size() - first_row ); i < n; ++i )
+
+          if( match[ keys[ i ] ] ) rows.push_back( std::uint32_t( first_row + i ) );
+      }
+    }
+
+    column_stats stats () const {
+
+      column_stats s{ _codes.size() * sizeof( T ), _codes.bytes() + _dictionary.size() * sizeof( T ), {}, _dictionary.size() };
+
+      _codes.count( s.blocks );
+
+      return s;
+    }
+
+    std::vector< T > _dictionary;
+    packed_column _codes;
+  };
+
+
+  template<typename T> struct column_codecs;
+
+  template<template<typename...> class L, typename... TT> struct column_codecs< L<TT...> > {
+
+    using type = luple< column_codec< TT >... >;
+  };
+
+
+  //member index of a nuple name
+  template<typename R, typename K> struct column_index {
+
+    static const int value = tlist_get_n< typename R::name_list, K >::value;
+
+    static_assert( value != -1, "no such name" );
+  };
+
+
+  //R - row type: luple_t< type_list<...> > or nuple
+
+  template<typename R> struct column_store {
+
+    using row_type = R;
+    using type_list = typename R::type_list;
+
+    column_store () {}
+
+    column_store ( R const * rows, std::size_t n ) : _size{ n } { build_( rows, std::make_integer_sequence< int, type_list::size >{} ); }
+
+    explicit column_store ( std::vector< R > const & rows ) : column_store( rows.data(), rows.size() ) {}
+
+    std::size_t size () const { return _size; }
+
+    //row i, decoded
+    R row ( std::size_t i ) const { return row_( i, std::make_integer_sequence< int, type_list::size >{} ); }
+
+    //member N of row i
+    template<int N>
+    auto at ( std::size_t i ) const { return luple_ns::get< N >( _columns ).at( i ); }
+
+    //f( row id, value ) for every row
+    template<int N, typename F>
+    void scan ( F && f ) const { luple_ns::get< N >( _columns ).scan( std::forward<F>( f ) ); }
+
+    //ids of rows with lo <= member N <= hi, in order
+    template<int N>
+    std::vector< std::uint32_t > filter ( element_t< R, N > const & lo, element_t< R, N > const & hi ) const {
+
+      std::vector< std::uint32_t > rows;
+
+      luple_ns::get< N >( _columns ).filter( lo, hi, rows );
+
+      return rows;
+    }
+
+    //ids of rows with pred( member N ), in order
+    template<int N, typename F>
+    std::vector< std::uint32_t > filter ( F && pred ) const {
+
+      std::vector< std::uint32_t > rows;
+
+      luple_ns::get< N >( _columns ).filter( std::forward<F>( pred ), rows );
+
+      return rows;
+    }
+
+    template<int N>
+    column_stats stats () const { return luple_ns::get< N >( _columns ).stats(); }
+
+    //nuple members by name: at< $("px") >( i ), filter< $("qty") >( lo, hi ) ...
+
+    template<typename K>
+    auto at ( std::size_t i ) const { return at< column_index< R, K >::value >( i ); }
+
+    template<typename K, typename F>
+    void scan ( F && f ) const { scan< column_index< R, K >::value >( std::forward<F>( f ) ); }
+
+    template<typename K, typename... AA>
+    std::vector< std::uint32_t > filter ( AA &&... args ) const { return filter< column_index< R, K >::value >( std::forward<AA>( args )... ); }
+
+    template<typename K>
+    column_stats stats () const { return stats< column_index< R, K >::value >(); }
+
+  private:
+
+    template<int... NN>
+    void build_ ( R const * rows, std::integer_sequence<int, NN...> ) {
+
+      char dummy[] = { ( luple_ns::get< NN >( _columns ).build( _size, [=]( std::size_t i ) -> auto const & { return luple_ns::get< NN >( rows[ i ] ); } ), char{} )... };
+      (void) dummy;
+    }
+
+    template<int... NN>
+    R row_ ( std::size_t i, std::integer_sequence<int, NN...> ) const { return R{ luple_ns::get< NN >( _columns ).at( i )... }; }
+
+    std::size_t _size = 0;
+    typename column_codecs< type_list >::type _columns;
+  };
+
+}
+
+
+//import into global namespace
+
+using luple_ns::column_store;
+using luple_ns::column_stats;
+
+#endif // LUPLE_COLUMN_H
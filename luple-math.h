@@ -0,0 +1,506 @@
+/*
+
+luple-math: element-wise arithmetic for homogeneous luples (C++14)
+
+License: Public-domain software
+
+Description:
+
+  A luple whose members all have the same arithmetic type ( luple< float, float, float, float >,
+  luple< double, double, double > ) is a small vector. Its layout is the same as an array of
+  that type (see luple.h), so operations are done on the flat array: with SSE/AVX registers
+  as wide as possible, then narrower registers, then scalar code for the tail. A luple of
+  4 floats is one SSE register, a luple of 3 doubles is one SSE2 register plus one scalar.
+
+  The same kernels work on arrays of such luples: an array of N luples of size M is an array
+  of N * M values, so batch operations run at full register width regardless of M.
+
+  Loads and stores are unaligned (no alignment requirement on luples), on current x86 they
+  are as fast as aligned ones when the data happens to be aligned.
+
+  SSE2 is used when the compiler targets it (__SSE2__, x64 on MSVC), AVX with __AVX__ and
+  FMA instructions with __FMA__. #define LUPLE_NO_SIMD to get scalar code only.
+  The operations are not constexpr.
+
+Dependencies:
+
+  luple.h: luple, luple_t
+  type_traits: std::is_arithmetic, std::is_same, std::enable_if_t
+  cstddef: std::size_t
+  immintrin.h: SSE/AVX intrinsics (when enabled)
+
+Usage:
+
+  #include "luple-math.h"
+
+  using vec4 = luple< float, float, float, float >;
+
+  vec4 a{ 1.f, 2.f, 3.f, 4.f }, b{ 4.f, 3.f, 2.f, 1.f };
+
+  vec4 c = a + b * 2.f;
+  c -= a;
+
+  float d = luple_dot( a, b );
+
+  vec4 lo = luple_min( a, b ), hi = luple_max( a, b );
+
+  vec4 e = luple_fma( a, b, c ); // a * b + c
+
+  //batch versions take arrays of luples and the number of luples
+
+  vec4 va[ 1024 ], vb[ 1024 ], vc[ 1024 ];
+  float dots[ 1024 ];
+
+  luple_add_n( va, vb, vc, 1024 ); // vc[i] = va[i] + vb[i]
+  luple_fma_n( va, vb, vc, vc, 1024 ); // vc[i] = va[i] * vb[i] + vc[i]
+  luple_dot_n( va, vb, dots, 1024 );
+
+  //also luple_sub_n, luple_mul_n, luple_div_n, luple_min_n, luple_max_n
+
+*/
+
+#ifndef LUPLE_MATH_H
+#define LUPLE_MATH_H
+
+#include <cstddef>
+#include <type_traits>
+
+#include "luple.h"
+
+
+#if !defined( LUPLE_NO_SIMD ) && ( defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 ) )
+  #define LUPLE_SSE
+#endif
+
+#if defined( LUPLE_SSE ) && defined( __AVX__ )
+  #define LUPLE_AVX
+#endif
+
+#if defined( LUPLE_AVX ) && defined( __FMA__ )
+  #define LUPLE_FMA
+#endif
+
+#ifdef LUPLE_SSE
+  #include <immintrin.h>
+#endif
+
+
+namespace luple_ns {
+
+
+  //luples with all members of the same arithmetic type
+
+  template<typename T> struct is_vec {
+
+    static const bool value = false;
+  };
+
+  template<typename T, typename... TT> struct is_vec< luple_t< type_list< T, TT... > > > {
+
+    static const bool value = std::is_arithmetic<T>::value &&
+      std::is_same< type_list< T, TT... >, type_list< TT..., T > >::value;
+  };
+
+  template<typename T, typename U = void>
+  using enable_if_vec_t = std::enable_if_t< is_vec< luple_t<T> >::value, U >;
+
+
+  //register types: simd_wide is the widest available, simd_narrow is used for the rest
+
+  template<typename T> struct simd_scalar {
+
+    using reg = T;
+
+    static const int width = 1;
+
+    static reg load ( T const * p ) { return *p; }
+    static void store ( T * p, reg r ) { *p = r; }
+  };
+
+  template<typename T> struct simd_wide : simd_scalar<T> {};
+  template<typename T> struct simd_narrow : simd_scalar<T> {};
+
+#ifdef LUPLE_SSE
+
+  template<> struct simd_narrow< float > {
+
+    using reg = __m128;
+
+    static const int width = 4;
+
+    static reg load ( float const * p ) { return _mm_loadu_ps( p ); }
+    static void store ( float * p, reg r ) { _mm_storeu_ps( p, r ); }
+  };
+
+  template<> struct simd_narrow< double > {
+
+    using reg = __m128d;
+
+    static const int width = 2;
+
+    static reg load ( double const * p ) { return _mm_loadu_pd( p ); }
+    static void store ( double * p, reg r ) { _mm_storeu_pd( p, r ); }
+  };
+
+#endif
+
+#if defined( LUPLE_SSE ) && !defined( LUPLE_AVX )
+
+  template<> struct simd_wide< float > : simd_narrow< float > {};
+  template<> struct simd_wide< double > : simd_narrow< double > {};
+
+#endif
+
+#ifdef LUPLE_AVX
+
+  template<> struct simd_wide< float > {
+
+    using reg = __m256;
+
+    static const int width = 8;
+
+    static reg load ( float const * p ) { return _mm256_loadu_ps( p ); }
+    static void store ( float * p, reg r ) { _mm256_storeu_ps( p, r ); }
+  };
+
+  template<> struct simd_wide< double > {
+
+    using reg = __m256d;
+
+    static const int width = 4;
+
+    static reg load ( double const * p ) { return _mm256_loadu_pd( p ); }
+    static void store ( double * p, reg r ) { _mm256_storeu_pd( p, r ); }
+  };
+
+#endif
+
+
+  //operations, the templated call operator is the scalar fallback
+
+  struct vec_add {
+
+    template<typename T> T operator() ( T a, T b ) const { return a + b; }
+
+#ifdef LUPLE_SSE
+    __m128 operator() ( __m128 a, __m128 b ) const { return _mm_add_ps( a, b ); }
+    __m128d operator() ( __m128d a, __m128d b ) const { return _mm_add_pd( a, b ); }
+#endif
+#ifdef LUPLE_AVX
+    __m256 operator() ( __m256 a, __m256 b ) const { return _mm256_add_ps( a, b ); }
+    __m256d operator() ( __m256d a, __m256d b ) const { return _mm256_add_pd( a, b ); }
+#endif
+  };
+
+  struct vec_sub {
+
+    template<typename T> T operator() ( T a, T b ) const { return a - b; }
+
+#ifdef LUPLE_SSE
+    __m128 operator() ( __m128 a, __m128 b ) const { return _mm_sub_ps( a, b ); }
+    __m128d operator() ( __m128d a, __m128d b ) const { return _mm_sub_pd( a, b ); }
+#endif
+#ifdef LUPLE_AVX
+    __m256 operator() ( __m256 a, __m256 b ) const { return _mm256_sub_ps( a, b ); }
+    __m256d operator() ( __m256d a, __m256d b ) const { return _mm256_sub_pd( a, b ); }
+#endif
+  };
+
+  struct vec_mul {
+
+    template<typename T> T operator() ( T a, T b ) const { return a * b; }
+
+#ifdef LUPLE_SSE
+    __m128 operator() ( __m128 a, __m128 b ) const { return _mm_mul_ps( a, b ); }
+    __m128d operator() ( __m128d a, __m128d b ) const { return _mm_mul_pd( a, b ); }
+#endif
+#ifdef LUPLE_AVX
+    __m256 operator() ( __m256 a, __m256 b ) const { return _mm256_mul_ps( a, b ); }
+    __m256d operator() ( __m256d a, __m256d b ) const { return _mm256_mul_pd( a, b ); }
+#endif
+  };
+
+  struct vec_div {
+
+    template<typename T> T operator() ( T a, T b ) const { return a / b; }
+
+#ifdef LUPLE_SSE
+    __m128 operator() ( __m128 a, __m128 b ) const { return _mm_div_ps( a, b ); }
+    __m128d operator() ( __m128d a, __m128d b ) const { return _mm_div_pd( a, b ); }
+#endif
+#ifdef LUPLE_AVX
+    __m256 operator() ( __m256 a, __m256 b ) const { return _mm256_div_ps( a, b ); }
+    __m256d operator() ( __m256d a, __m256d b ) const { return _mm256_div_pd( a, b ); }
+#endif
+  };
+
+  //min and max follow the SSE semantics: the second argument is returned for NaNs
+
+  struct vec_min {
+
+    template<typename T> T operator() ( T a, T b ) const { return a < b ? a : b; }
+
+#ifdef LUPLE_SSE
+    __m128 operator() ( __m128 a, __m128 b ) const { return _mm_min_ps( a, b ); }
+    __m128d operator() ( __m128d a, __m128d b ) const { return _mm_min_pd( a, b ); }
+#endif
+#ifdef LUPLE_AVX
+    __m256 operator() ( __m256 a, __m256 b ) const { return _mm256_min_ps( a, b ); }
+    __m256d operator() ( __m256d a, __m256d b ) const { return _mm256_min_pd( a, b ); }
+#endif
+  };
+
+  struct vec_max {
+
+    template<typename T> T operator() ( T a, T b ) const { return a > b ? a : b; }
+
+#ifdef LUPLE_SSE
+    __m128 operator() ( __m128 a, __m128 b ) const { return _mm_max_ps( a, b ); }
+    __m128d operator() ( __m128d a, __m128d b ) const { return _mm_max_pd( a, b ); }
+#endif
+#ifdef LUPLE_AVX
+    __m256 operator() ( __m256 a, __m256 b ) const { return _mm256_max_ps( a, b ); }
+    __m256d operator() ( __m256d a, __m256d b ) const { return _mm256_max_pd( a, b ); }
+#endif
+  };
+
+  //a * b + c, a single rounding only with FMA instructions
+
+  struct vec_fma {
+
+    template<typename T> T operator() ( T a, T b, T c ) const { return a * b + c; }
+
+#ifdef LUPLE_SSE
+  #ifdef LUPLE_FMA
+    __m128 operator() ( __m128 a, __m128 b, __m128 c ) const { return _mm_fmadd_ps( a, b, c ); }
+    __m128d operator() ( __m128d a, __m128d b, __m128d c ) const { return _mm_fmadd_pd( a, b, c ); }
+    __m256 operator() ( __m256 a, __m256 b, __m256 c ) const { return _mm256_fmadd_ps( a, b, c ); }
+    __m256d operator() ( __m256d a, __m256d b, __m256d c ) const { return _mm256_fmadd_pd( a, b, c ); }
+  #else
+    __m128 operator() ( __m128 a, __m128 b, __m128 c ) const { return _mm_add_ps( _mm_mul_ps( a, b ), c ); }
+    __m128d operator() ( __m128d a, __m128d b, __m128d c ) const { return _mm_add_pd( _mm_mul_pd( a, b ), c ); }
+  #endif
+#endif
+#if defined( LUPLE_AVX ) && !defined( LUPLE_FMA )
+    __m256 operator() ( __m256 a, __m256 b, __m256 c ) const { return _mm256_add_ps( _mm256_mul_ps( a, b ), c ); }
+    __m256d operator() ( __m256d a, __m256d b, __m256d c ) const { return _mm256_add_pd( _mm256_mul_pd( a, b ), c ); }
+#endif
+  };
+
+
+  //runs fn over n values: wide registers, then narrow registers, then scalars
+
+  template<typename T, typename F, typename... PP>
+  void vec_apply ( std::size_t n, F fn, T * out, PP const *... in ) {
+
+    using wide = simd_wide<T>;
+    using narrow = simd_narrow<T>;
+
+    std::size_t i = 0;
+
+    for( ; i + wide::width <= n; i += wide::width ) wide::store( out + i, fn( wide::load( in + i )... ) );
+
+    for( ; i + narrow::width <= n; i += narrow::width ) narrow::store( out + i, fn( narrow::load( in + i )... ) );
+
+    for( ; i < n; ++i ) out[i] = fn( in[i]... );
+  }
+
+
+  //a luple of vec type as a flat array
+
+  template<typename T>
+  auto vec_data ( luple_t<T> & l ) {
+
+    static_assert( sizeof( luple_t<T> ) == sizeof( tlist_get_t<T, 0> ) * T::size, "luple layout is not an array" );
+
+    return &get<0>( l );
+  }
+
+  template<typename T>
+  auto vec_data ( luple_t<T> const & l ) {
+
+    static_assert( sizeof( luple_t<T> ) == sizeof( tlist_get_t<T, 0> ) * T::size, "luple layout is not an array" );
+
+    return &get<0>( l );
+  }
+
+  template<typename T, typename F>
+  luple_t<T> vec_binary ( luple_t<T> const & a, luple_t<T> const & b, F fn ) {
+
+    luple_t<T> r;
+
+    vec_apply( T::size, fn, vec_data( r ), vec_data( a ), vec_data( b ) );
+
+    return r;
+  }
+
+  template<typename T>
+  luple_t<T> vec_fill ( tlist_get_t<T, 0> value ) {
+
+    luple_t<T> r;
+
+    luple_do( r, [value]( auto & v ) { v = value; } );
+
+    return r;
+  }
+
+
+  //element-wise arithmetic
+
+  template<typename T, typename = enable_if_vec_t<T>>
+  luple_t<T> operator + ( luple_t<T> const & a, luple_t<T> const & b ) { return vec_binary( a, b, vec_add{} ); }
+
+  template<typename T, typename = enable_if_vec_t<T>>
+  luple_t<T> operator - ( luple_t<T> const & a, luple_t<T> const & b ) { return vec_binary( a, b, vec_sub{} ); }
+
+  template<typename T, typename = enable_if_vec_t<T>>
+  luple_t<T> operator * ( luple_t<T> const & a, luple_t<T> const & b ) { return vec_binary( a, b, vec_mul{} ); }
+
+  template<typename T, typename = enable_if_vec_t<T>>
+  luple_t<T> operator / ( luple_t<T> const & a, luple_t<T> const & b ) { return vec_binary( a, b, vec_div{} ); }
+
+  //with a scalar
+
+  template<typename T, typename = enable_if_vec_t<T>>
+  luple_t<T> operator + ( luple_t<T> const & a, tlist_get_t<T, 0> b ) { return a + vec_fill<T>( b ); }
+
+  template<typename T, typename = enable_if_vec_t<T>>
+  luple_t<T> operator - ( luple_t<T> const & a, tlist_get_t<T, 0> b ) { return a - vec_fill<T>( b ); }
+
+  template<typename T, typename = enable_if_vec_t<T>>
+  luple_t<T> operator * ( luple_t<T> const & a, tlist_get_t<T, 0> b ) { return a * vec_fill<T>( b ); }
+
+  template<typename T, typename = enable_if_vec_t<T>>
+  luple_t<T> operator * ( tlist_get_t<T, 0> a, luple_t<T> const & b ) { return vec_fill<T>( a ) * b; }
+
+  template<typename T, typename = enable_if_vec_t<T>>
+  luple_t<T> operator / ( luple_t<T> const & a, tlist_get_t<T, 0> b ) { return a / vec_fill<T>( b ); }
+
+  //compound assignment
+
+  template<typename T, typename U, typename = enable_if_vec_t<T>>
+  luple_t<T> & operator += ( luple_t<T> & a, U const & b ) { return a = a + b; }
+
+  template<typename T, typename U, typename = enable_if_vec_t<T>>
+  luple_t<T> & operator -= ( luple_t<T> & a, U const & b ) { return a = a - b; }
+
+  template<typename T, typename U, typename = enable_if_vec_t<T>>
+  luple_t<T> & operator *= ( luple_t<T> & a, U const & b ) { return a = a * b; }
+
+  template<typename T, typename U, typename = enable_if_vec_t<T>>
+  luple_t<T> & operator /= ( luple_t<T> & a, U const & b ) { return a = a / b; }
+
+
+  //min, max, fused multiply-add, dot product
+
+  template<typename T, typename = enable_if_vec_t<T>>
+  luple_t<T> luple_min ( luple_t<T> const & a, luple_t<T> const & b ) { return vec_binary( a, b, vec_min{} ); }
+
+  template<typename T, typename = enable_if_vec_t<T>>
+  luple_t<T> luple_max ( luple_t<T> const & a, luple_t<T> const & b ) { return vec_binary( a, b, vec_max{} ); }
+
+  template<typename T, typename = enable_if_vec_t<T>>
+  luple_t<T> luple_fma ( luple_t<T> const & a, luple_t<T> const & b, luple_t<T> const & c ) {
+
+    luple_t<T> r;
+
+    vec_apply( T::size, vec_fma{}, vec_data( r ), vec_data( a ), vec_data( b ), vec_data( c ) );
+
+    return r;
+  }
+
+  template<typename T, typename = enable_if_vec_t<T>>
+  auto luple_dot ( luple_t<T> const & a, luple_t<T> const & b ) {
+
+    auto m = a * b;
+    tlist_get_t<T, 0> sum{};
+
+    luple_do( m, [&sum]( auto v ) { sum += v; } );
+
+    return sum;
+  }
+
+
+  //batch versions over arrays of n luples, n can be 0 (the pointers are not used then)
+
+  template<typename T, typename = enable_if_vec_t<T>>
+  void luple_add_n ( luple_t<T> const * a, luple_t<T> const * b, luple_t<T> * out, std::size_t n ) {
+
+    if( n == 0 ) return;
+
+    vec_apply( n * T::size, vec_add{}, vec_data( *out ), vec_data( *a ), vec_data( *b ) );
+  }
+
+  template<typename T, typename = enable_if_vec_t<T>>
+  void luple_sub_n ( luple_t<T> const * a, luple_t<T> const * b, luple_t<T> * out, std::size_t n ) {
+
+    if( n == 0 ) return;
+
+    vec_apply( n * T::size, vec_sub{}, vec_data( *out ), vec_data( *a ), vec_data( *b ) );
+  }
+
+  template<typename T, typename = enable_if_vec_t<T>>
+  void luple_mul_n ( luple_t<T> const * a, luple_t<T> const * b, luple_t<T> * out, std::size_t n ) {
+
+    if( n == 0 ) return;
+
+    vec_apply( n * T::size, vec_mul{}, vec_data( *out ), vec_data( *a ), vec_data( *b ) );
+  }
+
+  template<typename T, typename = enable_if_vec_t<T>>
+  void luple_div_n ( luple_t<T> const * a, luple_t<T> const * b, luple_t<T> * out, std::size_t n ) {
+
+    if( n == 0 ) return;
+
+    vec_apply( n * T::size, vec_div{}, vec_data( *out ), vec_data( *a ), vec_data( *b ) );
+  }
+
+  template<typename T, typename = enable_if_vec_t<T>>
+  void luple_min_n ( luple_t<T> const * a, luple_t<T> const * b, luple_t<T> * out, std::size_t n ) {
+
+    if( n == 0 ) return;
+
+    vec_apply( n * T::size, vec_min{}, vec_data( *out ), vec_data( *a ), vec_data( *b ) );
+  }
+
+  template<typename T, typename = enable_if_vec_t<T>>
+  void luple_max_n ( luple_t<T> const * a, luple_t<T> const * b, luple_t<T> * out, std::size_t n ) {
+
+    if( n == 0 ) return;
+
+    vec_apply( n * T::size, vec_max{}, vec_data( *out ), vec_data( *a ), vec_data( *b ) );
+  }
+
+  template<typename T, typename = enable_if_vec_t<T>>
+  void luple_fma_n ( luple_t<T> const * a, luple_t<T> const * b, luple_t<T> const * c, luple_t<T> * out, std::size_t n ) {
+
+    if( n == 0 ) return;
+
+    vec_apply( n * T::size, vec_fma{}, vec_data( *out ), vec_data( *a ), vec_data( *b ), vec_data( *c ) );
+  }
+
+  template<typename T, typename = enable_if_vec_t<T>>
+  void luple_dot_n ( luple_t<T> const * a, luple_t<T> const * b, tlist_get_t<T, 0> * out, std::size_t n ) {
+
+    for( std::size_t i = 0; i < n; ++i ) out[i] = luple_dot( a[i], b[i] );
+  }
+
+}
+
+
+//import into global namespace
+
+using luple_ns::luple_min;
+using luple_ns::luple_max;
+using luple_ns::luple_fma;
+using luple_ns::luple_dot;
+using luple_ns::luple_add_n;
+using luple_ns::luple_sub_n;
+using luple_ns::luple_mul_n;
+using luple_ns::luple_div_n;
+using luple_ns::luple_min_n;
+using luple_ns::luple_max_n;
+using luple_ns::luple_fma_n;
+using luple_ns::luple_dot_n;
+
+#endif // LUPLE_MATH_H
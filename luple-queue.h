@@ -0,0 +1,443 @@
+/*
+
+luple-queue: bounded lock-free queues of luple records with batch operations (C++14)
+
+License: Public-domain software
+
+Description:
+
+  spsc_queue< T > (one producer, one consumer) and mpmc_queue< T > (any number of both) are
+  ring buffers of luple_t< T > records (T is a type_list, as in luple_t< T >). push_n and
+  pop_n move a batch of records at once: the positions are claimed once per batch and the
+  records are copied in at most two contiguous runs (the ring wraps), with memcpy when the
+  luple is trivially copyable.
+
+  The producer and consumer positions are on separate cache lines. spsc_queue keeps a cached
+  copy of the other side's position and reads the shared one only when the cache says the
+  queue is full (empty). mpmc_queue has a sequence number per slot (in a separate array, the
+  records stay contiguous) that tells whether the slot is free for the writer of a position
+  or holds a finished record for its reader. A thread counts the ready slots from its
+  position and claims them with one CAS, so no thread ever waits for another: a slot that
+  is claimed but not yet written (read) ends the batch, as if the queue were empty (full)
+  there, and a preempted thread only holds back the positions it claimed.
+
+  The second parameter selects the slot layout: queue_aos stores luples, queue_soa stores
+  one array per member. push_columns / pop_columns take one pointer per member and copy
+  every column with memcpy in the soa layout (they work with both layouts).
+
+  push_n and pop_n never block, they return the number of records moved (0 on a full or
+  empty queue). The capacity is rounded up to a power of two.
+
+Dependencies:
+
+  luple.h: luple_t, luple, type_list
+  atomic, memory, cstring, cstddef, algorithm
+
+Usage:
+
+  #include "luple-queue.h"
+
+  using order_t = luple_ns::type_list< std::uint64_t, double, int >;
+
+  spsc_queue< order_t > q{ 4096 };
+
+  //producer
+  luple_t< order_t > batch[ 64 ];
+  auto pushed = q.push_n( batch, 64 );
+  q.push( { 1, 10.5, 100 } );
+
+  //consumer
+  luple_t< order_t > out[ 64 ];
+  auto popped = q.pop_n( out, 64 );
+
+  //columns
+  mpmc_queue< order_t, queue_soa > m{ 4096 };
+
+  std::uint64_t ids[ 64 ]; double prices[ 64 ]; int qtys[ 64 ];
+  m.push_columns( 64, ids, prices, qtys );
+  m.pop_columns( 64, ids, prices, qtys );
+
+  //bench/queue-bench.cpp compares throughput and latency with a mutex and a std::deque
+
+*/
+
+#ifndef LUPLE_QUEUE_H
+#define LUPLE_QUEUE_H
+
+#include <atomic>
+#include <memory>
+#include <cstring>
+#include <cstddef>
+#include <algorithm>
+#include <utility>
+#include <type_traits>
+
+#include "luple.h"
+
+
+namespace luple_ns {
+
+
+  //slot layouts
+  struct queue_aos {};
+  struct queue_soa {};
+
+
+  //write( i, in, n ), read( i, out, n ) - records in slots [ i, i + n ), no wrap around
+  //write_columns / read_columns - the same for n rows of the columns starting at row j
+
+  template<typename T, typename L> struct queue_storage;
+
+  template<typename... TT> struct queue_storage< type_list<TT...>, queue_aos > {
+
+    using value_type = luple< TT... >;
+
+    explicit queue_storage ( std::size_t n ) : _data{ new value_type[ n ] } {}
+
+    void write ( std::size_t i, value_type const * in, std::size_t n ) { copy_( _data.get() + i, in, n ); }
+
+    void read ( std::size_t i, value_type * out, std::size_t n ) { copy_( out, _data.get() + i, n ); }
+
+    void write_columns ( std::size_t i, std::size_t j, std::size_t n, TT const *... in ) {
+
+      columns_( std::make_integer_sequence< int, sizeof...(TT) >{}, [&]( auto N, auto const * column ) {
+
+        for( std::size_t k = 0; k < n; ++k ) get< decltype( N )::value >( _data[ i + k ] ) = column[ j + k ];
+
+      }, in... );
+    }
+
+    void read_columns ( std::size_t i, std::size_t j, std::size_t n, TT *... out ) {
+
+      columns_( std::make_integer_sequence< int, sizeof...(TT) >{}, [&]( auto N, auto * column ) {
+
+        for( std::size_t k = 0; k < n; ++k ) column[ j + k ] = get< decltype( N )::value >( _data[ i + k ] );
+
+      }, out... );
+    }
+
+  private:
+
+    static void copy_ ( value_type * out, value_type const * in, std::size_t n ) {
+
+      copy_( out, in, n, std::is_trivially_copyable< value_type >{} );
+    }
+
+    static void copy_ ( value_type * out, value_type const * in, std::size_t n, std::true_type ) { std::memcpy( out, in, n * sizeof( value_type ) ); }
+
+    static void copy_ ( value_type * out, value_type const * in, std::size_t n, std::false_type ) { std::copy( in, in + n, out ); }
+
+    template<int... NN, typename F, typename... UU>
+    static void columns_ ( std::integer_sequence<int, NN...>, F && f, UU *... columns ) {
+
+      char dummy[] = { ( f( std::integral_constant<int, NN>{}, columns ), char{} )..., char{} };
+      (void) dummy;
+    }
+
+    std::unique_ptr< value_type[] > _data;
+  };
+
+  template<typename... TT> struct queue_storage< type_list<TT...>, queue_soa > {
+
+    using value_type = luple< TT... >;
+
+    explicit queue_storage ( std::size_t n ) : _columns{ new TT[ n ]... } {}
+
+    ~queue_storage () { luple_do( _columns, []( auto * column ) { delete[] column; } ); }
+
+    queue_storage ( queue_storage const & ) = delete;
+    queue_storage & operator= ( queue_storage const & ) = delete;
+
+    void write ( std::size_t i, value_type const * in, std::size_t n ) {
+
+      each_( [&]( auto N, auto * column ) {
+
+        for( std::size_t k = 0; k < n; ++k ) column[ i + k ] = get< decltype( N )::value >( in[ k ] );
+      } );
+    }
+
+    void read ( std::size_t i, value_type * out, std::size_t n ) {
+
+      each_( [&]( auto N, auto * column ) {
+
+        for( std::size_t k = 0; k < n; ++k ) get< decltype( N )::value >( out[ k ] ) = column[ i + k ];
+      } );
+    }
+
+    void write_columns ( std::size_t i, std::size_t j, std::size_t n, TT const *... in ) {
+
+      luple< TT const *... > from{ in... };
+
+      each_( [&]( auto N, auto * column ) { copy_( column + i, get< decltype( N )::value >( from ) + j, n ); } );
+    }
+
+    void read_columns ( std::size_t i, std::size_t j, std::size_t n, TT *... out ) {
+
+      luple< TT *... > to{ out... };
+
+      each_( [&]( auto N, auto * column ) { copy_( get< decltype( N )::value >( to ) + j, column + i, n ); } );
+    }
+
+  private:
+
+    template<typename U>
+    static void copy_ ( U * out, U const * in, std::size_t n ) {
+
+      copy_( out, in, n, std::is_trivially_copyable< U >{} );
+    }
+
+    template<typename U>
+    static void copy_ ( U * out, U const * in, std::size_t n, std::true_type ) { std::memcpy( out, in, n * sizeof( U ) ); }
+
+    template<typename U>
+    static void copy_ ( U * out, U const * in, std::size_t n, std::false_type ) { std::copy( in, in + n, out ); }
+
+    template<typename F>
+    void each_ ( F && f ) { each_( f, std::make_integer_sequence< int, sizeof...(TT) >{} ); }
+
+    template<typename F, int... NN>
+    void each_ ( F & f, std::integer_sequence<int, NN...> ) {
+
+      char dummy[] = { ( f( std::integral_constant<int, NN>{}, get< NN >( _columns ) ), char{} )..., char{} };
+      (void) dummy;
+    }
+
+    luple< TT *... > _columns;
+  };
+
+
+  //smallest power of two >= n
+  inline std::size_t queue_capacity ( std::size_t n ) {
+
+    std::size_t c = 1;
+
+    while( c < n ) c <<= 1;
+
+    return c;
+  }
+
+
+  //common part: records and column access over a ring of slots
+
+  template<typename D, typename T, typename L>
+  struct queue_base {
+
+    using value_type = luple_t< T >;
+
+    explicit queue_base ( std::size_t capacity ) : _capacity{ queue_capacity( capacity ) }, _data{ _capacity } {}
+
+    bool push ( value_type const & v ) { return push_n( &v, 1 ) == 1; }
+
+    bool pop ( value_type & v ) { return pop_n( &v, 1 ) == 1; }
+
+    //up to n records, returns the number of records moved
+    std::size_t push_n ( value_type const * in, std::size_t n ) {
+
+      return self_().push_( n, [&]( std::size_t i, std::size_t j, std::size_t k ) { _data.write( i, in + j, k ); } );
+    }
+
+    std::size_t pop_n ( value_type * out, std::size_t n ) {
+
+      return self_().pop_( n, [&]( std::size_t i, std::size_t j, std::size_t k ) { _data.read( i, out + j, k ); } );
+    }
+
+    //one pointer per member
+    template<typename... UU>
+    std::size_t push_columns ( std::size_t n, UU const *... in ) {
+
+      return self_().push_( n, [&]( std::size_t i, std::size_t j, std::size_t k ) { _data.write_columns( i, j, k, in... ); } );
+    }
+
+    template<typename... UU>
+    std::size_t pop_columns ( std::size_t n, UU *... out ) {
+
+      return self_().pop_( n, [&]( std::size_t i, std::size_t j, std::size_t k ) { _data.read_columns( i, j, k, out... ); } );
+    }
+
+    std::size_t capacity () const { return _capacity; }
+
+  protected:
+
+    //copy( slot, offset in the batch, count ) for the records at positions [ pos, pos + n )
+    template<typename F>
+    void copy_ ( std::size_t pos, std::size_t n, F & copy ) {
+
+      std::size_t i = pos & ( _capacity - 1 );
+      std::size_t first = std::min( n, _capacity - i );
+
+      copy( i, 0, first );
+
+      if( n > first ) copy( 0, first, n - first );
+    }
+
+    D & self_ () { return static_cast< D & >( *this ); }
+
+    std::size_t _capacity;
+    queue_storage< T, L > _data;
+  };
+
+
+  //one producer thread, one consumer thread
+
+  template<typename T, typename L = queue_aos>
+  struct spsc_queue : queue_base< spsc_queue<T, L>, T, L > {
+
+    using base = queue_base< spsc_queue<T, L>, T, L >;
+
+    explicit spsc_queue ( std::size_t capacity ) : base{ capacity } {}
+
+    //number of records, approximate when called concurrently
+    std::size_t size () const { return _head.load( std::memory_order_acquire ) - _tail.load( std::memory_order_acquire ); }
+
+  private:
+
+    friend base;
+
+    template<typename F>
+    std::size_t push_ ( std::size_t n, F && copy ) {
+
+      auto head = _head.load( std::memory_order_relaxed );
+
+      if( this->_capacity - ( head - _tail_cache ) < n ) _tail_cache = _tail.load( std::memory_order_acquire );
+
+      n = std::min( n, this->_capacity - ( head - _tail_cache ) );
+
+      if( n == 0 ) return 0;
+
+      this->copy_( head, n, copy );
+
+      _head.store( head + n, std::memory_order_release );
+
+      return n;
+    }
+
+    template<typename F>
+    std::size_t pop_ ( std::size_t n, F && copy ) {
+
+      auto tail = _tail.load( std::memory_order_relaxed );
+
+      if( _head_cache - tail < n ) _head_cache = _head.load( std::memory_order_acquire );
+
+      n = std::min( n, _head_cache - tail );
+
+      if( n == 0 ) return 0;
+
+      this->copy_( tail, n, copy );
+
+      _tail.store( tail + n, std::memory_order_release );
+
+      return n;
+    }
+
+    //producer line
+    alignas( LUPLE_CACHE_LINE ) std::atomic< std::size_t > _head{ 0 };
+    std::size_t _tail_cache = 0;
+
+    //consumer line
+    alignas( LUPLE_CACHE_LINE ) std::atomic< std::size_t > _tail{ 0 };
+    std::size_t _head_cache = 0;
+  };
+
+
+  //any number of producers and consumers
+
+  template<typename T, typename L = queue_aos>
+  struct mpmc_queue : queue_base< mpmc_queue<T, L>, T, L > {
+
+    using base = queue_base< mpmc_queue<T, L>, T, L >;
+
+    //slot i is free for the writer of position i
+    explicit mpmc_queue ( std::size_t capacity ) : base{ capacity }, _seq{ new std::atomic< std::size_t >[ this->_capacity ] } {
+
+      for( std::size_t i = 0; i < this->_capacity; ++i ) _seq[ i ].store( i, std::memory_order_relaxed );
+    }
+
+    std::size_t size () const {
+
+      auto tail = _tail.load( std::memory_order_acquire );
+      auto head = _head.load( std::memory_order_acquire );
+
+      return head > tail ? head - tail : 0;
+    }
+
+  private:
+
+    friend base;
+
+    template<typename F>
+    std::size_t push_ ( std::size_t n, F && copy ) {
+
+      //slot of position p is free when its sequence is p
+      auto head = claim_( _head, n, 0 );
+      std::size_t k = head.second;
+
+      if( k == 0 ) return 0;
+
+      this->copy_( head.first, k, copy );
+
+      for( auto p = head.first; p != head.first + k; ++p ) seq_( p ).store( p + 1, std::memory_order_release );
+
+      return k;
+    }
+
+    template<typename F>
+    std::size_t pop_ ( std::size_t n, F && copy ) {
+
+      //slot of position p holds a record when its sequence is p + 1
+      auto tail = claim_( _tail, n, 1 );
+      std::size_t k = tail.second;
+
+      if( k == 0 ) return 0;
+
+      this->copy_( tail.first, k, copy );
+
+      for( auto p = tail.first; p != tail.first + k; ++p ) seq_( p ).store( p + this->_capacity, std::memory_order_release );
+
+      return k;
+    }
+
+    std::atomic< std::size_t > & seq_ ( std::size_t p ) { return _seq[ p & ( this->_capacity - 1 ) ]; }
+
+    //claims up to n ready positions from pos: ( first position, count ), ready is seq == p + lag
+    std::pair< std::size_t, std::size_t > claim_ ( std::atomic< std::size_t > & pos, std::size_t n, std::size_t lag ) {
+
+      auto p = pos.load( std::memory_order_relaxed );
+
+      for( ;; ) {
+
+        std::size_t k = 0;
+        std::ptrdiff_t d = 0;
+
+        for( ; k < n; ++k ) {
+
+          d = std::ptrdiff_t( seq_( p + k ).load( std::memory_order_acquire ) - ( p + k + lag ) );
+
+          if( d != 0 ) break;
+        }
+
+        //another thread moved pos past p: start over from its value
+        if( k == 0 && d > 0 ) { p = pos.load( std::memory_order_relaxed ); continue; }
+
+        //full (empty) or the next slot is still being written (read)
+        if( k == 0 ) return { p, 0 };
+
+        if( pos.compare_exchange_weak( p, p + k, std::memory_order_relaxed ) ) return { p, k };
+      }
+    }
+
+    alignas( LUPLE_CACHE_LINE ) std::atomic< std::size_t > _head{ 0 };
+    alignas( LUPLE_CACHE_LINE ) std::atomic< std::size_t > _tail{ 0 };
+    alignas( LUPLE_CACHE_LINE ) std::unique_ptr< std::atomic< std::size_t >[] > _seq;
+  };
+
+}
+
+
+//import into global namespace
+
+using luple_ns::spsc_queue;
+using luple_ns::mpmc_queue;
+using luple_ns::queue_aos;
+using luple_ns::queue_soa;
+
+#endif // LUPLE_QUEUE_H
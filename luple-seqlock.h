@@ -0,0 +1,157 @@
+/*
+
+luple-seqlock: a luple behind a sequence lock (C++14)
+
+License: Public-domain software
+
+Description:
+
+  seqlock_luple< T > (T is a type_list, as in luple_t< T >) holds a luple that one writer
+  updates and many readers read without locks. The writer makes the sequence counter odd,
+  writes all members, makes it even again. A reader copies the data and retries if the
+  counter was odd or changed during the copy, so it always gets a consistent (torn-free)
+  snapshot. Readers never write to shared memory: no atomic read-modify-write, no cache
+  line ping-pong between readers.
+
+  The data is kept in std::atomic< std::uint64_t > words that are read and written with
+  relaxed loads and stores (plain moves on x86), so the concurrent copy is not a data race.
+  This limits members to trivially copyable types.
+
+  There must be only one writer at a time (use a mutex between writers if needed).
+  A reader can starve if the writer updates continuously.
+
+Dependencies:
+
+  luple.h: luple_t, LUPLE_CACHE_LINE
+  atomic: std::atomic, std::atomic_thread_fence
+  cstring: std::memcpy
+  cstdint: std::uint64_t
+
+Usage:
+
+  #include "luple-seqlock.h"
+
+  using state_t = luple_ns::type_list< double, double, int64_t >;
+
+  seqlock_luple< state_t > state;
+
+  //writer thread
+  state.store( { bid, ask, ts } );
+
+  //reader threads
+  luple_t< state_t > s = state.load();
+
+  //bench/seqlock-bench.cpp compares reader scaling with a mutex and an atomic shared_ptr
+
+*/
+
+#ifndef LUPLE_SEQLOCK_H
+#define LUPLE_SEQLOCK_H
+
+#include <atomic>
+#include <cstring>
+#include <cstdint>
+#include <type_traits>
+
+#include "luple.h"
+
+
+namespace luple_ns {
+
+
+  //on its own cache line, LUPLE_CACHE_LINE (luple.h)
+  template<typename T>
+  struct alignas( LUPLE_CACHE_LINE ) seqlock_luple {
+
+    using value_type = luple_t<T>;
+
+    static_assert( std::is_trivially_copyable< value_type >::value, "seqlock_luple needs trivially copyable members" );
+
+    static const int words = ( sizeof( value_type ) + sizeof( std::uint64_t ) - 1 ) / sizeof( std::uint64_t );
+
+    //zero-filled
+    seqlock_luple () {
+
+      for( auto & w : _data ) w.store( 0, std::memory_order_relaxed );
+    }
+
+    seqlock_luple ( value_type const & v ) {
+
+      std::uint64_t buf[ words ] = {};
+
+      std::memcpy( buf, &v, sizeof( value_type ) );
+
+      for( int i = 0; i < words; ++i ) _data[ i ].store( buf[ i ], std::memory_order_relaxed );
+    }
+
+    seqlock_luple ( seqlock_luple const & ) = delete;
+    seqlock_luple & operator= ( seqlock_luple const & ) = delete;
+
+
+    //single writer
+
+    void store ( value_type const & v ) {
+
+      std::uint64_t buf[ words ] = {};
+
+      std::memcpy( buf, &v, sizeof( value_type ) );
+
+      auto seq = _seq.load( std::memory_order_relaxed );
+
+      _seq.store( seq + 1, std::memory_order_relaxed );
+
+      //data stores can't move above the odd counter
+      std::atomic_thread_fence( std::memory_order_release );
+
+      for( int i = 0; i < words; ++i ) _data[ i ].store( buf[ i ], std::memory_order_relaxed );
+
+      _seq.store( seq + 2, std::memory_order_release );
+    }
+
+
+    //any number of readers
+
+    value_type load () const {
+
+      std::uint64_t buf[ words ];
+
+      for( ;; ) {
+
+        auto seq0 = _seq.load( std::memory_order_acquire );
+
+        for( int i = 0; i < words; ++i ) buf[ i ] = _data[ i ].load( std::memory_order_relaxed );
+
+        //data loads can't move below the second counter read
+        std::atomic_thread_fence( std::memory_order_acquire );
+
+        auto seq1 = _seq.load( std::memory_order_relaxed );
+
+        if( seq0 == seq1 && ( seq0 & 1 ) == 0 ) break;
+      }
+
+      value_type v;
+
+      std::memcpy( &v, buf, sizeof( value_type ) );
+
+      return v;
+    }
+
+
+    //number of completed stores
+
+    auto version () const { return _seq.load( std::memory_order_acquire ) / 2; }
+
+  private:
+
+    std::atomic< std::uint64_t > _seq{ 0 };
+    std::atomic< std::uint64_t > _data[ words ];
+  };
+
+}
+
+
+//import into global namespace
+
+using luple_ns::seqlock_luple;
+
+#endif // LUPLE_SEQLOCK_H
@@ -0,0 +1,464 @@
+/*
+
+luple-table: static lookup tables of luples sorted at compile time (C++14)
+
+License: Public-domain software
+
+Description:
+
+  A constexpr array of luples can be sorted at compile time: luple_sort< keys< N... > >( rows )
+  is a constexpr heap sort on the members N... (lexicographic, char const* members compare
+  as strings).
+
+  make_static_table< keys< N... >, Layout >( rows ) builds a static_table at compile time,
+  declared constexpr it goes to read-only data: no sorting at startup. find( key... )
+  returns a pointer to the row or nullptr. Layouts:
+
+    table_sorted    - rows in key order, branchless binary search (the loop has no
+                      data-dependent branches, the comparison becomes a conditional move),
+                      lower_bound( key... ) for ranges
+    table_eytzinger - rows in Eytzinger (breadth-first) order: the first levels of the
+                      search share cache lines, branchless too
+    table_hash      - rows in key order plus a perfect hash index for a single integral
+                      or enum key: two loads and a compare per lookup. The hash is built
+                      at compile time (hash and displace), keys should be unique
+
+  Large tables may need -fconstexpr-ops-limit (GCC) or -fconstexpr-steps (Clang).
+
+Dependencies:
+
+  luple.h: luple, get, element_t
+  cstdint, cstddef, stdexcept, type_traits
+
+Usage:
+
+  #include "luple-table.h"
+
+  using element_t = luple< int, char const*, double >;
+
+  constexpr element_t elements[] = { { 8, "O", 15.999 }, { 1, "H", 1.008 }, { 6, "C", 12.011 } };
+
+  constexpr auto by_number = make_static_table< keys< 0 > >( elements );
+  constexpr auto by_symbol = make_static_table< keys< 1 >, table_eytzinger >( elements );
+  constexpr auto by_hash = make_static_table< keys< 0 >, table_hash >( elements );
+
+  static_assert( get< 1 >( *by_number.find( 6 ) )[0] == 'C', "" );
+
+  element_t const * o = by_symbol.find( "O" );
+  element_t const * c = by_hash.find( 6 );
+
+  for( auto & e : by_number ) ...; //in key order (except table_eytzinger)
+
+*/
+
+#ifndef LUPLE_TABLE_H
+#define LUPLE_TABLE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <type_traits>
+
+#include "luple.h"
+
+
+namespace luple_ns {
+
+
+  //key members of a table
+  template<int... NN> struct keys {};
+
+  //layouts
+  struct table_sorted {};
+  struct table_eytzinger {};
+  struct table_hash {};
+
+
+  //comparison of key values
+
+  template<typename A, typename B>
+  constexpr bool table_less ( A const & a, B const & b ) { return a < b; }
+
+  constexpr bool table_less ( char const * a, char const * b ) {
+
+    while( *a && *a == *b ) ++a, ++b;
+
+    return (unsigned char) *a < (unsigned char) *b;
+  }
+
+
+  //1-based position of the lowest zero bit, ffs( ~i ), the loop is for compilers without
+  //the builtin (MSVC's _BitScanForward isn't constexpr)
+  constexpr int table_lowest_zero ( unsigned i ) {
+
+  #if defined( __GNUC__ ) || defined( __clang__ )
+    return __builtin_ffs( int( ~i ) );
+  #else
+    int n = 1;
+
+    for( ; i & 1; i >>= 1 ) ++n;
+
+    return n;
+  #endif
+  }
+
+
+  //row < row on the members NN...
+  template<typename L>
+  constexpr bool rows_less ( L const &, L const &, keys<> ) { return false; }
+
+  template<typename L, int N, int... NN>
+  constexpr bool rows_less ( L const & a, L const & b, keys<N, NN...> ) {
+
+    return table_less( get<N>( a ), get<N>( b ) ) || ( ! table_less( get<N>( b ), get<N>( a ) ) && rows_less( a, b, keys<NN...>{} ) );
+  }
+
+  //row < key and key < row, K - luple of the key values
+  template<int I, typename L, typename K>
+  constexpr bool row_key_less ( L const &, K const &, keys<> ) { return false; }
+
+  template<int I, typename L, typename K, int N, int... NN>
+  constexpr bool row_key_less ( L const & r, K const & k, keys<N, NN...> ) {
+
+    return table_less( get<N>( r ), get<I>( k ) ) || ( ! table_less( get<I>( k ), get<N>( r ) ) && row_key_less<I + 1>( r, k, keys<NN...>{} ) );
+  }
+
+  template<int I, typename L, typename K>
+  constexpr bool key_row_less ( K const &, L const &, keys<> ) { return false; }
+
+  template<int I, typename L, typename K, int N, int... NN>
+  constexpr bool key_row_less ( K const & k, L const & r, keys<N, NN...> ) {
+
+    return table_less( get<I>( k ), get<N>( r ) ) || ( ! table_less( get<N>( r ), get<I>( k ) ) && key_row_less<I + 1>( k, r, keys<NN...>{} ) );
+  }
+
+
+  template<typename L>
+  constexpr void table_swap ( L & a, L & b ) {
+
+    L t = a;
+    a = b;
+    b = t;
+  }
+
+  template<typename K, typename L>
+  constexpr void table_sift ( L * rows, int i, int size ) {
+
+    for( int child = 2 * i + 1; child < size; child = 2 * i + 1 ) {
+
+      if( child + 1 < size && rows_less( rows[ child ], rows[ child + 1 ], K{} ) ) ++child;
+
+      if( ! rows_less( rows[ i ], rows[ child ], K{} ) ) return;
+
+      table_swap( rows[ i ], rows[ child ] );
+
+      i = child;
+    }
+  }
+
+  //constexpr heap sort of n luples on the key members K = keys< N... >
+  template<typename K, typename L>
+  constexpr void luple_sort ( L * rows, int n ) {
+
+    for( int i = n / 2 - 1; i >= 0; --i ) table_sift<K>( rows, i, n );
+
+    for( int size = n - 1; size > 0; --size ) {
+
+      table_swap( rows[ 0 ], rows[ size ] );
+
+      table_sift<K>( rows, 0, size );
+    }
+  }
+
+  template<typename K, typename L, int N>
+  constexpr void luple_sort ( L ( & rows )[ N ] ) { luple_sort<K>( rows, N ); }
+
+
+  //mixing function of the perfect hash
+  constexpr std::uint64_t table_mix ( std::uint64_t x ) {
+
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdull;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ull;
+    x ^= x >> 33;
+
+    return x;
+  }
+
+  constexpr std::size_t table_pow2 ( std::size_t n ) {
+
+    std::size_t c = 1;
+
+    while( c < n ) c <<= 1;
+
+    return c;
+  }
+
+
+  //perfect hash index: bucket = h & ( B - 1 ), slot = mix( h ^ displacement[ bucket ] ) & ( M - 1 )
+
+  template<int Size, bool Enabled> struct table_index {};
+
+  template<int Size> struct table_index< Size, true > {
+
+    static const std::size_t slots = table_pow2( 2 * Size );
+    static const std::size_t buckets = table_pow2( ( Size + 3 ) / 4 );
+
+    std::uint64_t displacement[ buckets ];
+    int slot[ slots ]; //row index, empty slots point to row 0
+
+    static constexpr std::uint64_t hash ( std::uint64_t key ) { return table_mix( key ); }
+
+    constexpr int find ( std::uint64_t h ) const { return slot[ table_mix( h ^ displacement[ h & ( buckets - 1 ) ] ) & ( slots - 1 ) ]; }
+
+    //hashes - of the rows
+    constexpr void build ( std::uint64_t const * hashes ) {
+
+      int count[ buckets ] = {};
+      int start[ buckets + 1 ] = {};
+      int order[ Size ] = {};
+      bool taken[ slots ] = {};
+      std::size_t placed[ Size ] = {};
+
+      for( int i = 0; i < Size; ++i ) ++count[ hashes[ i ] & ( buckets - 1 ) ];
+
+      for( std::size_t b = 0; b < buckets; ++b ) start[ b + 1 ] = start[ b ] + count[ b ];
+
+      int fill[ buckets ] = {};
+
+      for( int i = 0; i < Size; ++i ) {
+
+        auto b = hashes[ i ] & ( buckets - 1 );
+
+        order[ start[ b ] + fill[ b ]++ ] = i;
+      }
+
+      int largest = 0;
+
+      for( std::size_t b = 0; b < buckets; ++b ) if( count[ b ] > largest ) largest = count[ b ];
+
+      //the biggest buckets first
+      for( int size = largest; size > 0; --size )
+
+        for( std::size_t b = 0; b < buckets; ++b ) {
+
+          if( count[ b ] != size ) continue;
+
+          for( std::uint64_t d = 1; ; ++d ) {
+
+            int n = 0;
+
+            for( ; n < size; ++n ) {
+
+              auto s = table_mix( hashes[ order[ start[ b ] + n ] ] ^ d ) & ( slots - 1 );
+
+              if( taken[ s ] ) break;
+
+              taken[ s ] = true;
+              placed[ n ] = s;
+            }
+
+            if( n == size ) { displacement[ b ] = d; break; }
+
+            while( n-- ) taken[ placed[ n ] ] = false;
+          }
+
+          for( int n = 0; n < size; ++n ) slot[ placed[ n ] ] = order[ start[ b ] + n ];
+        }
+    }
+  };
+
+
+  //T - luple, K - keys< N... >, Size - number of rows
+
+  template<typename T, typename K, int Size, typename Layout = table_sorted>
+  struct static_table;
+
+  template<typename T, int... NN, int Size, typename Layout>
+  struct static_table< T, keys<NN...>, Size, Layout > {
+
+    static_assert( sizeof...(NN) > 0, "no key members" );
+    static_assert( Size > 0, "empty table" );
+
+    static const bool hashed = std::is_same< Layout, table_hash >::value;
+
+    using key_t = luple< std::decay_t< element_t< T, NN > >... >;
+
+    template<int... II>
+    constexpr static_table ( T const * rows, std::integer_sequence<int, II...> ) : _rows{ rows[ II ]... }, _index{} {
+
+      luple_sort< keys<NN...> >( _rows, Size );
+
+      build_( Layout{} );
+    }
+
+
+    //pointer to the row with the key or nullptr
+    template<typename... UU>
+    constexpr T const * find ( UU const &... args ) const {
+
+      static_assert( sizeof...(UU) == sizeof...(NN), "a value for every key member" );
+
+      return find_( key_t{ args... }, Layout{} );
+    }
+
+    //first row not less than the key (table_sorted, table_hash)
+    template<typename... UU>
+    constexpr T const * lower_bound ( UU const &... args ) const {
+
+      static_assert( ! std::is_same< Layout, table_eytzinger >::value, "rows of table_eytzinger are not in key order" );
+
+      return _rows + lower_bound_( key_t{ args... } );
+    }
+
+    constexpr T const * begin () const { return _rows; }
+    constexpr T const * end () const { return _rows + Size; }
+
+    constexpr T const & operator[] ( int i ) const { return _rows[ i ]; }
+
+    static constexpr int size () { return Size; }
+
+  private:
+
+    constexpr int lower_bound_ ( key_t const & k ) const {
+
+      int base = 0;
+
+      for( int n = Size; n > 1; ) {
+
+        int half = n / 2;
+
+        base = row_key_less<0>( _rows[ base + half - 1 ], k, keys<NN...>{} ) ? base + half : base;
+
+        n -= half;
+      }
+
+      return base + row_key_less<0>( _rows[ base ], k, keys<NN...>{} );
+    }
+
+    constexpr bool equal_ ( T const & r, key_t const & k ) const { return ! key_row_less<0>( k, r, keys<NN...>{} ) && ! row_key_less<0>( r, k, keys<NN...>{} ); }
+
+    constexpr T const * find_ ( key_t const & k, table_sorted ) const {
+
+      int i = lower_bound_( k );
+
+      return i < Size && equal_( _rows[ i ], k ) ? _rows + i : nullptr;
+    }
+
+    //1-based positions: children of k are 2k and 2k + 1
+    constexpr T const * find_ ( key_t const & k, table_eytzinger ) const {
+
+      unsigned i = 1;
+
+      while( i <= unsigned( Size ) ) i = 2 * i + row_key_less<0>( _rows[ i - 1 ], k, keys<NN...>{} );
+
+      //undo the right turns after the last left one
+      i >>= table_lowest_zero( i );
+
+      return i && equal_( _rows[ i - 1 ], k ) ? _rows + i - 1 : nullptr;
+    }
+
+    constexpr T const * find_ ( key_t const & k, table_hash ) const {
+
+      int i = _index.find( _index.hash( std::uint64_t( get<0>( k ) ) ) );
+
+      return get< first_key >( _rows[ i ] ) == get<0>( k ) ? _rows + i : nullptr;
+    }
+
+
+    constexpr void build_ ( table_sorted ) {}
+
+    //sorted position of every Eytzinger position, then the permutation in place
+    constexpr void build_ ( table_eytzinger ) {
+
+      int from[ Size ] = {};
+      int next = 0;
+
+      eytzinger_( from, next, 1 );
+
+      bool done[ Size ] = {};
+
+      //every cycle of the permutation: position j takes the row from[ j ]
+      for( int i = 0; i < Size; ++i ) {
+
+        if( done[ i ] ) continue;
+
+        T first = _rows[ i ];
+
+        int j = i;
+
+        for( ; from[ j ] != i; j = from[ j ] ) {
+
+          _rows[ j ] = _rows[ from[ j ] ];
+
+          done[ j ] = true;
+        }
+
+        _rows[ j ] = first;
+
+        done[ j ] = true;
+      }
+    }
+
+    constexpr void eytzinger_ ( int * from, int & next, int k ) {
+
+      if( k > Size ) return;
+
+      eytzinger_( from, next, 2 * k );
+
+      from[ k - 1 ] = next++;
+
+      eytzinger_( from, next, 2 * k + 1 );
+    }
+
+    constexpr void build_ ( table_hash ) {
+
+      static_assert( sizeof...(NN) == 1, "table_hash works with a single key member" );
+      using U = element_t< T, first_key >;
+
+      static_assert( std::is_integral<U>::value || std::is_enum<U>::value, "table_hash needs an integral or enum key" );
+
+      std::uint64_t hashes[ Size ] = {};
+
+      for( int i = 0; i < Size; ++i ) {
+
+        if( i && get< first_key >( _rows[ i - 1 ] ) == get< first_key >( _rows[ i ] ) )
+
+          throw std::invalid_argument( "duplicate keys in a table_hash static_table" );
+
+        hashes[ i ] = _index.hash( std::uint64_t( get< first_key >( _rows[ i ] ) ) );
+      }
+
+      _index.build( hashes );
+    }
+
+    static const int first_key = tlist_get_t< type_list< std::integral_constant<int, NN>... >, 0 >::value;
+
+    T _rows[ Size ];
+
+    table_index< Size, hashed > _index;
+  };
+
+
+  //make_static_table< keys< N... >, Layout >( rows )
+  template<typename K, typename Layout = table_sorted, typename T, int Size>
+  constexpr auto make_static_table ( T const ( & rows )[ Size ] ) {
+
+    return static_table< T, K, Size, Layout >{ rows, std::make_integer_sequence< int, Size >{} };
+  }
+
+}
+
+
+//import into global namespace
+
+using luple_ns::keys;
+using luple_ns::static_table;
+using luple_ns::make_static_table;
+using luple_ns::table_sorted;
+using luple_ns::table_eytzinger;
+using luple_ns::table_hash;
+using luple_ns::luple_sort;
+
+#endif // LUPLE_TABLE_H
@@ -15,6 +15,16 @@ Description:
 
   Still, luple is not a POD, so you're on your own if you reinterpret_cast it. Luple can be 
   used in constexpr functions. 
+
+  Empty non-final members (tags, stateless comparators and allocators) are stored as base
+  classes and take no space: sizeof( luple< empty_tag, int > ) == sizeof( int ). Note that
+  this differs from a struct with an empty data member.
+
+  Uses-allocator construction: luple_t{ std::allocator_arg, alloc, args... } passes alloc to
+  every member that takes an allocator (std::uses_allocator), other members are constructed
+  from their arguments as usual. std::uses_allocator is true for a luple with such a member,
+  so allocator-aware containers (std::pmr, std::scoped_allocator_adaptor) pass their allocator
+  down into the members. See luple-arena.h for a monotonic arena.
   
   Initially it was created as part of a structure data member types reading experiment.
   Check the struct-reader.h file for more details.
@@ -23,6 +33,7 @@ Dependencies:
 
   utility: std::integer_sequence, std::forward, std::move
   type_traits: std::conditional_t, std::is_same, std::enable_if
+  memory: std::allocator_arg_t, std::uses_allocator
 
 Usage:
 
@@ -107,6 +118,41 @@ Usage:
       return as_luple( std::string{ "alex"}, id );
     }
 
+  padded_luple ( members on separate cache lines, no false sharing between threads ):
+
+    padded_luple< std::atomic<int>, std::atomic<int> > counters; //sizeof is 2 * LUPLE_CACHE_LINE
+
+    get< 0 >( counters )++; //thread 0
+    get< 1 >( counters )++; //thread 1
+
+    //group members that are written together in a nested luple
+    padded_luple< luple< int, int >, int > cursors;
+
+  luple_cat ( similar to tuple_cat, but flat: members go directly into the result ):
+
+    luple< int, float > l0{ 1, 2.f };
+    luple< std::string > l1{ "hello" };
+
+    auto l2 = luple_cat( l0, std::move( l1 ) ); //luple< int, float, std::string >
+
+    auto v = luple_cat_view( l0, l2 ); //luple< int&, float&, int&, float&, std::string& >
+
+    get< 0 >( v ) = 10; //changes get< 0 >( l0 )
+
+  allocators ( uses-allocator construction, similar to tuple ):
+
+    std::pmr::monotonic_buffer_resource mr;
+
+    using record_t = luple< std::pmr::string, int, std::pmr::vector< int > >;
+
+    record_t r0{ std::allocator_arg, &mr, "a string that doesn't fit SSO", 1, std::initializer_list< int >{ 1, 2 } };
+
+    record_t r1{ std::allocator_arg, &mr, r0 }; //copy, members allocate from mr
+
+    auto r2 = as_luple( std::allocator_arg, &mr, std::pmr::string{ "hello" }, 2 );
+
+    std::pmr::vector< record_t > v( &mr ); //records and their members allocate from mr
+
 
 */
 
@@ -115,6 +161,7 @@ Usage:
 
 #include <utility>
 #include <type_traits>
+#include <memory>
 
 
 namespace luple_ns {
@@ -151,6 +198,20 @@ namespace luple_ns {
   using tlist_get_t = typename tlist_get<T, N>::type;
 
 
+  //concatenate type lists, the result is a plain type_list (padded_list members lose padding)
+  template<typename... TT> struct tlist_cat;
+
+  template<template<typename...> class L, template<typename...> class M, typename... TT, typename... UU, typename... RR>
+  struct tlist_cat< L<TT...>, M<UU...>, RR... > : tlist_cat< type_list<TT..., UU...>, RR... > {};
+
+  template<template<typename...> class L, typename... TT> struct tlist_cat< L<TT...> > { using type = type_list<TT...>; };
+
+  template<> struct tlist_cat<> { using type = type_list<>; };
+
+  template<typename... TT>
+  using tlist_cat_t = typename tlist_cat<TT...>::type;
+
+
   //get element index by type
   template<typename T, typename U, int N = 0> struct tlist_get_n;
 
@@ -165,6 +226,25 @@ namespace luple_ns {
   };
 
 
+  //type list for padded_luple: every member is aligned (and padded) to a cache line
+
+  #ifndef LUPLE_CACHE_LINE
+    #define LUPLE_CACHE_LINE 64
+  #endif
+
+  template<typename... TT> struct padded_list : type_list<TT...> {
+
+    template<typename... UU> struct add {
+
+      using type = padded_list< TT..., UU... >;
+    };
+  };
+
+  template<typename... TT, int N, int M> struct tlist_get< padded_list<TT...>, N, M > : tlist_get< type_list<TT...>, N, M > {};
+
+  template<typename... TT, typename U, int N> struct tlist_get_n< padded_list<TT...>, U, N > : tlist_get_n< type_list<TT...>, U, N > {};
+
+
   //helper template to check for a reference in a parameter pack
   template<typename... TT> struct has_reference;
 
@@ -206,22 +286,147 @@ namespace luple_ns {
   };
 
 
+  //luple_t< T > for luple_t and classes derived from it (nuple), void for other types
+  template<typename T> luple_t<T> * luple_based_ ( luple_t<T> const * );
+
+  void * luple_based_ ( void const * );
+
+  template<typename U>
+  using luple_based_t = std::remove_pointer_t< decltype( luple_based_( static_cast< std::decay_t<U> * >( nullptr ) ) ) >;
+
+  //a single luple argument picks a converting constructor
+  template<typename... UU> struct luple_arg : std::false_type {};
+
+  template<typename U> struct luple_arg< U > : std::integral_constant< bool, ! std::is_same< luple_based_t<U>, void >::value > {};
+
+  //forwards an argument, a luple (or nuple) is passed as its luple_t base
+  template<typename U, typename L = luple_based_t<U>> struct luple_arg_ {
+
+    using type = std::conditional_t< std::is_lvalue_reference<U>::value, L const &, L && >;
+  };
+
+  template<typename U> struct luple_arg_< U, void > {
+
+    using type = U &&;
+  };
+
+  template<typename U>
+  using luple_arg_t = typename luple_arg_<U>::type;
+
+
+  //uses-allocator construction of a member:
+  //V( std::allocator_arg, a, args... ), V( args..., a ) or V( args... ) if V doesn't take A
+
+  template<typename V, typename A, typename... UU> struct uses_allocator_kind {
+
+    static const bool uses = std::uses_allocator< V, A >::value;
+
+    static const int value = ! uses ? 0 : std::is_constructible< V, std::allocator_arg_t, A const &, UU... >::value ? 1 : 2;
+  };
+
+  template<typename V, typename A, typename... UU>
+  constexpr V uses_allocator_make_ ( std::integral_constant< int, 0 >, A const &, UU &&... args ) { return V( std::forward<UU>( args )... ); }
+
+  template<typename V, typename A, typename... UU>
+  constexpr V uses_allocator_make_ ( std::integral_constant< int, 1 >, A const & a, UU &&... args ) { return V( std::allocator_arg, a, std::forward<UU>( args )... ); }
+
+  template<typename V, typename A, typename... UU>
+  constexpr V uses_allocator_make_ ( std::integral_constant< int, 2 >, A const & a, UU &&... args ) { return V( std::forward<UU>( args )..., a ); }
+
+  template<typename V, typename A, typename... UU>
+  constexpr V uses_allocator_make ( A const & a, UU &&... args ) {
+
+    using kind = std::integral_constant< int, uses_allocator_kind< V, A, UU... >::value >;
+
+    return uses_allocator_make_< V >( kind{}, a, std::forward<UU>( args )... );
+  }
+
+  //std::uses_allocator for a luple: some member takes the allocator
+  template<typename T, typename A> struct luple_uses_allocator;
+
+  template<template<typename...> class L, typename... TT, typename A> struct luple_uses_allocator< L<TT...>, A > :
+
+    std::integral_constant< bool, ! std::is_same< std::integer_sequence< bool, std::uses_allocator< TT, A >::value... >,
+                                                  std::integer_sequence< bool, ( sizeof( TT * ), false )... > >::value > {};
+
+
+  //empty non-final members are stored as a base class (empty base optimization)
+  template<typename T, int N> struct luple_compress {
+
+    using value_type = tlist_get_t<T, N>;
+
+    static const bool value = std::is_empty< value_type >::value && ! std::is_final< value_type >::value;
+  };
+
+  //members of a padded_luple keep their own cache line
+  template<typename... TT, int N> struct luple_compress< padded_list<TT...>, N > {
+
+    static const bool value = false;
+  };
+
+
   //a building block that is used in multiple inheritane
-  template<typename T, int N> struct luple_element {
+  template<typename T, int N, bool E = luple_compress<T, N>::value> struct luple_element {
+
+    using value_type = tlist_get_t<T, N>;
+
+    value_type _value;
+  };
+
+  template<typename T, int N>
+  constexpr tlist_get_t<T, N> & element_value ( luple_element< T, N, true > & e );
+
+  template<typename T, int N>
+  constexpr tlist_get_t<T, N> const & element_value ( luple_element< T, N, true > const & e );
+
+  //an empty member takes no space, the base is private: the luple doesn't get its interface
+  //(operators, conversions), the value is reached only through element_value
+  template<typename T, int N> struct luple_element< T, N, true > : private tlist_get_t<T, N> {
 
     using value_type = tlist_get_t<T, N>;
 
+    luple_element () = default;
+
+    template<typename U>
+    constexpr luple_element ( U && v ) : value_type( std::forward<U>( v ) ) {}
+
+    template<typename U, int M>
+    friend constexpr tlist_get_t<U, M> & element_value ( luple_element< U, M, true > & e );
+
+    template<typename U, int M>
+    friend constexpr tlist_get_t<U, M> const & element_value ( luple_element< U, M, true > const & e );
+  };
+
+  //members of a padded_luple don't share cache lines (no false sharing between threads)
+  template<typename... TT, int N> struct alignas( LUPLE_CACHE_LINE ) luple_element< padded_list<TT...>, N, false > {
+
+    using value_type = tlist_get_t< type_list<TT...>, N >;
+
     value_type _value;
   };
 
 
+  //access to the member of a luple_element
+  template<typename T, int N, bool E>
+  constexpr auto & element_value ( luple_element< T, N, E > & e ) { return e._value; }
+
+  template<typename T, int N, bool E>
+  constexpr auto & element_value ( luple_element< T, N, E > const & e ) { return e._value; }
+
+  template<typename T, int N>
+  constexpr tlist_get_t<T, N> & element_value ( luple_element< T, N, true > & e ) { return static_cast< tlist_get_t<T, N> & >( e ); }
+
+  template<typename T, int N>
+  constexpr tlist_get_t<T, N> const & element_value ( luple_element< T, N, true > const & e ) { return static_cast< tlist_get_t<T, N> const & >( e ); }
+
+
   //base of luple and also parent of luple_element's
   template<typename T, typename U> struct luple_base;
 
-  template<typename... TT, int... NN>
-  struct luple_base< type_list<TT...>, std::integer_sequence<int, NN...> > : luple_element< type_list<TT...>, NN >... {
+  template<template<typename...> class L, typename... TT, int... NN>
+  struct luple_base< L<TT...>, std::integer_sequence<int, NN...> > : luple_element< L<TT...>, NN >... {
 
-    using tlist = type_list<TT...>;
+    using tlist = L<TT...>;
 
     //construction
     constexpr luple_base () {}
@@ -239,6 +444,22 @@ namespace luple_ns {
       static_assert( ! has_reference<TT...>::value, "a converting constructor can't be used with reference template parameters" );
     }
 
+    //uses-allocator construction
+    template<typename A>
+    constexpr luple_base ( std::allocator_arg_t, A const & a ) : luple_element< tlist, NN >{ uses_allocator_make< TT >( a ) }... {}
+
+    template<typename A, typename... UU, typename = std::enable_if_t< ! luple_arg<UU...>::value >>
+    constexpr luple_base ( std::allocator_arg_t, A const & a, UU &&... args ) :
+      luple_element< tlist, NN >{ uses_allocator_make< TT >( a, std::forward<UU>( args ) ) }... {}
+
+    template<typename A, typename U>
+    constexpr luple_base ( std::allocator_arg_t, A const & a, luple_t<U> const & o ) :
+      luple_element< tlist, NN >{ uses_allocator_make< TT >( a, o.template get<NN>() ) }... {}
+
+    template<typename A, typename U>
+    constexpr luple_base ( std::allocator_arg_t, A const & a, luple_t<U> && o ) :
+      luple_element< tlist, NN >{ uses_allocator_make< TT >( a, std::move( o.template get<NN>() ) ) }... {}
+
   };
 
 
@@ -276,6 +497,15 @@ namespace luple_ns {
       static_assert( U::size == size, "sizes of luples do not match" );
     }
 
+    //uses-allocator construction: luple_t{ std::allocator_arg, a }, luple_t{ std::allocator_arg, a, args... },
+    //luple_t{ std::allocator_arg, a, other_luple }
+    template<typename A, typename... UU>
+    constexpr luple_t ( std::allocator_arg_t, A && a, UU &&... args ) :
+      base{ std::allocator_arg, static_cast< std::remove_reference_t<A> const & >( a ), static_cast< luple_arg_t<UU> >( args )... } {
+
+      static_assert( sizeof...(UU) == 0 || sizeof...(UU) == size || luple_arg<UU...>::value, "wrong number of arguments" );
+    }
+
     //copying a different luple
     template<typename U>
     auto & operator= ( luple_t<U> const & r ) { 
@@ -317,28 +547,28 @@ namespace luple_ns {
 
       static_assert( N < size, "luple::get -> out of bounds access" );
 
-      return luple_element< T, N >::_value;
+      return element_value( static_cast< luple_element< T, N > & >( *this ) );
     }
 
     template<typename U> constexpr auto & get () {
 
       static_assert( tlist_get_n<T, U>::value != -1, "no such type in type list" );
 
-      return luple_element< T, tlist_get_n< T, U >::value >::_value;
+      return element_value( static_cast< luple_element< T, tlist_get_n< T, U >::value > & >( *this ) );
     }
 
     template<int N> constexpr auto & get () const {
 
       static_assert( N < T::size, "luple::get -> out of bounds access" );
 
-      return luple_element< T, N >::_value;
+      return element_value( static_cast< luple_element< T, N > const & >( *this ) );
     }
 
     template<typename U> constexpr auto & get () const {
 
       static_assert( tlist_get_n< T, U >::value != -1, "no such type in type list" );
 
-      return luple_element< T, tlist_get_n< T, U >::value >::_value;
+      return element_value( static_cast< luple_element< T, tlist_get_n< T, U >::value > const & >( *this ) );
     }
 
   };
@@ -348,6 +578,12 @@ namespace luple_ns {
   template<typename... TT>
   using luple = luple_t< type_list< TT... > >;
 
+  //padded_luple< TT... > - luple with each member on its own cache line, put members that
+  //are used together into a nested luple: padded_luple< luple< int, int >, int >
+
+  template<typename... TT>
+  using padded_luple = luple_t< padded_list< TT... > >;
+
 
   //get function helpers
 
@@ -405,11 +641,102 @@ namespace luple_ns {
 
 
   //as_luple( value0, value1 ... ) -> luple< decltype(value0), decltype(value1) ... >
+  //arguments are forwarded into the members: one copy for an lvalue, one move for an rvalue
 
   template<typename... TT>
-  constexpr auto as_luple ( TT... args ) {
+  constexpr auto as_luple ( TT &&... args ) {
+
+    return luple< std::decay_t<TT>... >{ std::forward<TT>( args )... };
+  }
+
+  //as_luple( std::allocator_arg, a, value0, value1 ... ), members that take an allocator get a
+
+  template<typename A, typename... TT>
+  constexpr auto as_luple ( std::allocator_arg_t, A && a, TT &&... args ) {
+
+    return luple< std::decay_t<TT>... >{ std::allocator_arg, a, std::forward<TT>( args )... };
+  }
+
+
+  //luple_cat helpers: a flat member index maps to ( luple index, member index ) pair
+
+  template<int... SS> struct cat_index {
+
+    static constexpr int outer ( int n ) {
 
-    return luple< TT... >{ std::move( args )... };
+      int const sizes[] = { SS..., 0 };
+      int i = 0;
+
+      while( n >= sizes[i] ) n -= sizes[i++];
+
+      return i;
+    }
+
+    static constexpr int inner ( int n ) {
+
+      int const sizes[] = { SS..., 0 };
+      int i = 0;
+
+      while( n >= sizes[i] ) n -= sizes[i++];
+
+      return n;
+    }
+  };
+
+  //moves a member out of an rvalue luple, leaves lvalues (and reference members) as is
+
+  template<typename L, int N>
+  constexpr decltype(auto) luple_cat_get ( std::remove_reference_t<L> & l ) {
+
+    using type = element_t< std::decay_t<L>, N >;
+    using ref = std::conditional_t< std::is_lvalue_reference<L>::value, decltype( get<N>( l ) ), type && >;
+
+    return static_cast< ref >( get<N>( l ) );
+  }
+
+  template<typename... LL, typename P, int... NN>
+  constexpr auto luple_cat_ ( type_list<LL...>, P & ptrs, std::integer_sequence<int, NN...> ) {
+
+    using index = cat_index< std::decay_t<LL>::size... >;
+    using tlist = tlist_cat_t< typename std::decay_t<LL>::type_list... >;
+
+    return luple_t< tlist >{ 
+      luple_cat_get< tlist_get_t< type_list<LL...>, index::outer( NN ) >, index::inner( NN ) >( *get< index::outer( NN ) >( ptrs ) )... 
+    };
+  }
+
+  template<typename... LL, typename P, int... NN>
+  constexpr auto luple_cat_view_ ( type_list<LL...>, P & ptrs, std::integer_sequence<int, NN...> ) {
+
+    using index = cat_index< std::decay_t<LL>::size... >;
+
+    return luple< decltype( get< index::inner( NN ) >( *get< index::outer( NN ) >( ptrs ) ) )... >{ 
+      get< index::inner( NN ) >( *get< index::outer( NN ) >( ptrs ) )... 
+    };
+  }
+
+
+  //luple_cat( l0, l1, ... ) -> luple< members of l0, members of l1, ... >
+  //members are moved from rvalue luples and copied from lvalues directly into the result
+
+  template<typename... LL>
+  constexpr auto luple_cat ( LL &&... args ) {
+
+    //pointers and not references: a luple with a single luple& member would pick a converting constructor
+    luple< std::remove_reference_t<LL> *... > ptrs{ &args... };
+
+    return luple_cat_( type_list<LL...>{}, ptrs, std::make_integer_sequence< int, tlist_cat_t< typename std::decay_t<LL>::type_list... >::size >{} );
+  }
+
+
+  //luple_cat_view( l0, l1, ... ) -> luple< references to members of l0, l1, ... >
+
+  template<typename... LL>
+  constexpr auto luple_cat_view ( LL &... args ) {
+
+    luple< LL *... > ptrs{ &args... };
+
+    return luple_cat_view_( type_list<LL...>{}, ptrs, std::make_integer_sequence< int, tlist_cat_t< typename std::decay_t<LL>::type_list... >::size >{} );
   }
 
 
@@ -486,14 +813,25 @@ namespace luple_ns {
 }
 
 
+//allocator-aware containers pass their allocator to a luple that has an allocator-aware member
+
+namespace std {
+
+  template<typename T, typename A> struct uses_allocator< luple_ns::luple_t<T>, A > : luple_ns::luple_uses_allocator< T, A > {};
+}
+
+
 //import into global namespace
 
 using luple_ns::luple;
 using luple_ns::luple_t;
+using luple_ns::padded_luple;
 using luple_ns::get;
 using luple_ns::index;
 using luple_ns::luple_tie;
 using luple_ns::luple_do;
 using luple_ns::as_luple;
+using luple_ns::luple_cat;
+using luple_ns::luple_cat_view;
 
 #endif // LUPLE_LUPLE_H
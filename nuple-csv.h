@@ -0,0 +1,493 @@
+/*
+
+nuple-csv: memory-mapped CSV/TSV loader into vectors of nuples (C++14, POSIX)
+
+License: Public-domain software
+
+Description:
+
+  load_csv< nuple<...> >( path ) maps the file into memory, matches the header line against
+  the nuple names (interned strings, see intern.h) and parses every line into a nuple.
+  Columns that are not in the nuple are skipped, the order of columns doesn't matter.
+
+  Field ends are found 16 bytes at a time with SSE2 compares when available. Integers are
+  parsed with a plain digit loop, floating point numbers with a fast path for up to 19
+  significant digits and small exponents (exact, Clinger's algorithm), the rest goes to
+  strtod. The file is split into chunks on line boundaries and chunks are parsed by
+  several threads.
+
+  Supported member types: integral types, bool (0/1, true/false), float, double,
+  std::string (copied) and, with C++17, std::string_view which points into the mapping, so
+  no copy is made. The mapping is owned by the returned csv_table and lives as long as it
+  does. parse_csv does the same on a buffer that is already in memory.
+
+  Members whose fields are missing (a short line) are value-initialized: zero, empty.
+
+  A field can be quoted to contain delimiters, quotes are stripped, "" escapes are not
+  unescaped. Newlines inside quoted fields are not supported. \r\n line ends are fine.
+
+  Errors (file can't be opened or mapped, a nuple name is not in the header) throw
+  std::runtime_error. A malformed number is parsed up to the first bad character.
+
+Dependencies:
+
+  nuple.h: nuple, name_t
+  vector, string, thread, stdexcept, cstring, cstdlib, cstdint
+  sys/mman.h, sys/stat.h, fcntl.h, unistd.h: mmap
+  emmintrin.h: SSE2 (when available)
+
+Usage:
+
+  #include "nuple-csv.h"
+
+  using trade_t = nuple< $("ts"), int64_t, $("sym"), std::string_view, $("px"), double >;
+
+  auto table = load_csv< trade_t >( "trades.csv" ); //or load_csv< trade_t >( "trades.tsv", '\t' )
+
+  for( auto const & t : table.rows ) ...
+
+  //number of threads, by default std::thread::hardware_concurrency()
+
+  auto table = load_csv< trade_t >( "trades.csv", ',', 4 );
+
+  //a buffer in memory, string_view members point into it
+
+  std::string text = "ts,sym,px\n1,IBM,10.5\n";
+
+  std::vector< trade_t > rows = parse_csv< trade_t >( text.data(), text.data() + text.size() );
+
+*/
+
+#ifndef NUPLE_CSV_H
+#define NUPLE_CSV_H
+
+#include <vector>
+#include <string>
+#include <thread>
+#include <stdexcept>
+#include <cstring>
+#include <cstdlib>
+#include <cstdint>
+#include <type_traits>
+
+#if __cplusplus >= 201703L
+  #include <string_view>
+#endif
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#if defined( __SSE2__ ) || defined( _M_X64 )
+  #define NUPLE_CSV_SSE
+  #include <emmintrin.h>
+#endif
+
+#include "nuple.h"
+
+
+namespace nuple_ns {
+
+
+  //read-only mapping of a whole file
+
+  struct csv_mapping {
+
+    csv_mapping ( char const * path ) {
+
+      int fd = ::open( path, O_RDONLY );
+
+      if( fd == -1 ) throw std::runtime_error{ std::string{ "load_csv: can't open " } + path };
+
+      struct stat st;
+
+      if( ::fstat( fd, &st ) == -1 ) {
+
+        ::close( fd );
+
+        throw std::runtime_error{ std::string{ "load_csv: can't stat " } + path };
+      }
+
+      _size = st.st_size;
+
+      if( _size > 0 ) {
+
+        void * p = ::mmap( nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0 );
+
+        if( p == MAP_FAILED ) {
+
+          ::close( fd );
+
+          throw std::runtime_error{ std::string{ "load_csv: can't map " } + path };
+        }
+
+        ::madvise( p, _size, MADV_SEQUENTIAL );
+
+        _data = static_cast< char const * >( p );
+      }
+
+      ::close( fd );
+    }
+
+    csv_mapping ( csv_mapping && o ) : _data{ o._data }, _size{ o._size } { o._data = nullptr; }
+
+    csv_mapping & operator= ( csv_mapping && o ) {
+
+      std::swap( _data, o._data );
+      std::swap( _size, o._size );
+
+      return *this;
+    }
+
+    ~csv_mapping () {
+
+      if( _data ) ::munmap( const_cast< char * >( _data ), _size );
+    }
+
+    char const * begin () const { return _data; }
+    char const * end () const { return _data + _size; }
+
+  private:
+
+    char const * _data = nullptr;
+    std::size_t _size = 0;
+  };
+
+
+  //rows and the mapping string_view members point into
+
+  template<typename R>
+  struct csv_table {
+
+    std::vector<R> rows;
+    csv_mapping mapping;
+  };
+
+
+  //first delimiter or newline in [p, end), end if none
+
+  inline char const * csv_find ( char const * p, char const * end, char delim ) {
+
+#ifdef NUPLE_CSV_SSE
+
+    __m128i const d = _mm_set1_epi8( delim );
+    __m128i const n = _mm_set1_epi8( '\n' );
+
+    for( ; end - p >= 16; p += 16 ) {
+
+      __m128i v = _mm_loadu_si128( reinterpret_cast< __m128i const * >( p ) );
+
+      int mask = _mm_movemask_epi8( _mm_or_si128( _mm_cmpeq_epi8( v, d ), _mm_cmpeq_epi8( v, n ) ) );
+
+      if( mask ) return p + __builtin_ctz( mask );
+    }
+
+#endif
+
+    for( ; p < end; ++p ) if( *p == delim || *p == '\n' ) return p;
+
+    return end;
+  }
+
+  inline char const * csv_find_newline ( char const * p, char const * end ) {
+
+    auto r = static_cast< char const * >( std::memchr( p, '\n', end - p ) );
+
+    return r ? r : end;
+  }
+
+
+  //field parsers, [p, e) is the field without quotes
+
+  template<typename T, typename = std::enable_if_t< std::is_integral<T>::value && ! std::is_same<T, bool>::value >>
+  void csv_parse ( char const * p, char const * e, T & v ) {
+
+    bool neg = false;
+
+    if( p < e && ( *p == '-' || *p == '+' ) ) neg = *p++ == '-';
+
+    std::make_unsigned_t<T> r = 0;
+
+    for( ; p < e && unsigned( *p - '0' ) < 10; ++p ) r = r * 10 + unsigned( *p - '0' );
+
+    v = neg ? T( -r ) : T( r );
+  }
+
+  //1 or true (any case), anything else is false
+  inline void csv_parse ( char const * p, char const * e, bool & v ) {
+
+    static char const t[] = "true";
+
+    int i = 0;
+
+    if( e - p == 4 ) while( i < 4 && ( p[ i ] | 0x20 ) == t[ i ] ) ++i;
+
+    v = i == 4 || ( e - p == 1 && *p == '1' );
+  }
+
+  inline double csv_parse_double ( char const * p, char const * e ) {
+
+    static double const pow10[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+      1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+    char const * s = p;
+    bool neg = false;
+
+    if( p < e && ( *p == '-' || *p == '+' ) ) neg = *p++ == '-';
+
+    std::uint64_t m = 0;
+    int digits = 0, exp = 0;
+
+    for( ; p < e && unsigned( *p - '0' ) < 10; ++p, ++digits ) m = m * 10 + unsigned( *p - '0' );
+
+    if( p < e && *p == '.' )
+
+      for( ++p; p < e && unsigned( *p - '0' ) < 10; ++p, ++digits, --exp ) m = m * 10 + unsigned( *p - '0' );
+
+    if( p < e && ( *p == 'e' || *p == 'E' ) ) {
+
+      int x = 0;
+      csv_parse( p + 1, e, x );
+      exp += x;
+    }
+
+    //exact when the mantissa fits 53 bits and the power of ten is exact
+    if( digits <= 19 && m < ( std::uint64_t{ 1 } << 53 ) && exp >= -22 && exp <= 22 ) {
+
+      double r = double( m );
+      r = exp < 0 ? r / pow10[ -exp ] : r * pow10[ exp ];
+
+      return neg ? -r : r;
+    }
+
+    std::string tmp{ s, e };
+
+    return std::strtod( tmp.c_str(), nullptr );
+  }
+
+  inline void csv_parse ( char const * p, char const * e, double & v ) { v = csv_parse_double( p, e ); }
+
+  inline void csv_parse ( char const * p, char const * e, float & v ) { v = float( csv_parse_double( p, e ) ); }
+
+  inline void csv_parse ( char const * p, char const * e, std::string & v ) { v.assign( p, e ); }
+
+#if __cplusplus >= 201703L
+  inline void csv_parse ( char const * p, char const * e, std::string_view & v ) { v = std::string_view( p, e - p ); }
+#endif
+
+
+  //parser of the member N of a nuple
+
+  template<typename R, int N>
+  void csv_parse_member ( R & r, char const * p, char const * e ) {
+
+    csv_parse( p, e, get<N>( r ) );
+  }
+
+  template<typename R>
+  struct csv_parser {
+
+    using member_fn = void ( * )( R &, char const *, char const * );
+
+    //column number -> member parser or nullptr
+    std::vector< member_fn > columns;
+    char delim;
+
+    void parse ( char const * p, char const * end, std::vector<R> & out ) const {
+
+      while( p < end ) {
+
+        char const * eol = csv_find_newline( p, end );
+
+        if( eol == p || ( eol - p == 1 && *p == '\r' ) ) { p = eol + 1; continue; }
+
+        R & r = add_row_( out, std::make_integer_sequence< int, R::size >{} );
+
+        for( std::size_t c = 0; c < columns.size() && p <= eol; ++c ) {
+
+          char const * b = p, * e;
+
+          if( p < eol && *p == '"' ) {
+
+            b = ++p;
+
+            while( p < eol && !( *p == '"' && ( p + 1 == eol || p[1] != '"' ) ) ) p += *p == '"' ? 2 : 1;
+
+            e = p;
+            p = csv_find( p, eol, delim );
+          }
+          else {
+
+            p = csv_find( p, eol, delim );
+            e = p;
+          }
+
+          if( e > b && e[-1] == '\r' && e == eol ) --e;
+
+          if( columns[ c ] ) columns[ c ]( r, b, e );
+
+          ++p;
+        }
+
+        p = eol + 1;
+      }
+    }
+
+  private:
+
+    //members are value-initialized, fields missing from a short line stay zero
+    template<int... NN>
+    static R & add_row_ ( std::vector<R> & out, std::integer_sequence<int, NN...> ) {
+
+      out.emplace_back( luple_ns::element_t< R, NN >{}... );
+
+      return out.back();
+    }
+  };
+
+
+  template<typename R, int... NN>
+  csv_parser<R> csv_make_parser ( char const * & p, char const * end, char delim, std::integer_sequence<int, NN...> ) {
+
+    using member_fn = typename csv_parser<R>::member_fn;
+
+    char const * names[] = { name_t< R, NN >::value... };
+    member_fn parsers[] = { &csv_parse_member< R, NN >... };
+    bool found[ sizeof...(NN) ] = {};
+
+    csv_parser<R> parser{ {}, delim };
+
+    char const * eol = csv_find_newline( p, end );
+
+    while( p <= eol && p < end ) {
+
+      char const * e = csv_find( p, eol, delim );
+      char const * b = p;
+
+      if( e > b && e[-1] == '\r' && e == eol ) e--;
+      if( e - b >= 2 && *b == '"' && e[-1] == '"' ) b++, e--;
+
+      member_fn fn = nullptr;
+
+      for( std::size_t i = 0; i < sizeof...(NN); ++i )
+
+        if( std::strlen( names[ i ] ) == std::size_t( e - b ) && std::memcmp( names[ i ], b, e - b ) == 0 ) {
+
+          fn = parsers[ i ];
+          found[ i ] = true;
+        }
+
+      parser.columns.push_back( fn );
+
+      p = csv_find( p, eol, delim ) + 1;
+    }
+
+    p = eol < end ? eol + 1 : end;
+
+    for( std::size_t i = 0; i < sizeof...(NN); ++i )
+
+      if( ! found[ i ] ) throw std::runtime_error{ std::string{ "load_csv: no column " } + names[ i ] };
+
+    return parser;
+  }
+
+
+  //load_csv< nuple<...> >( path, delimiter, threads )
+
+  template<typename R>
+  csv_table<R> load_csv ( char const * path, char delim = ',', int threads = 0 ) {
+
+    csv_table<R> table{ {}, csv_mapping{ path } };
+
+    char const * p = table.mapping.begin();
+    char const * end = table.mapping.end();
+
+    if( p == end ) return table;
+
+    auto parser = csv_make_parser<R>( p, end, delim, std::make_integer_sequence< int, R::size >{} );
+
+    if( threads <= 0 ) threads = std::thread::hardware_concurrency();
+
+    //small files are not worth the threads
+    std::size_t min_chunk = 1 << 20;
+
+    if( threads < 1 ) threads = 1;
+    if( std::size_t( end - p ) / min_chunk < std::size_t( threads ) ) threads = int( ( end - p ) / min_chunk ) + 1;
+
+    if( threads == 1 ) {
+
+      parser.parse( p, end, table.rows );
+
+      return table;
+    }
+
+    //chunk boundaries are moved to the next line start
+    std::vector< char const * > bounds{ p };
+
+    for( int t = 1; t < threads; ++t ) {
+
+      char const * b = p + ( end - p ) * t / threads;
+
+      if( b <= bounds.back() ) { bounds.push_back( bounds.back() ); continue; }
+
+      b = csv_find_newline( b - 1, end );
+
+      bounds.push_back( b < end ? b + 1 : end );
+    }
+
+    bounds.push_back( end );
+
+    std::vector< std::vector<R> > parts( threads );
+    std::vector< std::thread > pool;
+
+    for( int t = 0; t < threads; ++t )
+
+      pool.emplace_back( [&, t] { parser.parse( bounds[ t ], bounds[ t + 1 ], parts[ t ] ); } );
+
+    for( auto & t : pool ) t.join();
+
+    std::size_t size = 0;
+
+    for( auto const & part : parts ) size += part.size();
+
+    table.rows.reserve( size );
+
+    for( auto & part : parts )
+
+      for( auto & r : part ) table.rows.push_back( std::move( r ) );
+
+    return table;
+  }
+
+  //parse_csv< nuple<...> >( begin, end, delimiter ): a buffer with the header line, one thread
+
+  template<typename R>
+  std::vector<R> parse_csv ( char const * begin, char const * end, char delim = ',' ) {
+
+    std::vector<R> rows;
+
+    if( begin == end ) return rows;
+
+    auto parser = csv_make_parser<R>( begin, end, delim, std::make_integer_sequence< int, R::size >{} );
+
+    parser.parse( begin, end, rows );
+
+    return rows;
+  }
+
+  template<typename R>
+  csv_table<R> load_csv ( std::string const & path, char delim = ',', int threads = 0 ) {
+
+    return load_csv<R>( path.c_str(), delim, threads );
+  }
+
+}
+
+
+//import into global namespace
+
+using nuple_ns::load_csv;
+using nuple_ns::parse_csv;
+
+#endif // NUPLE_CSV_H
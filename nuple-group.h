@@ -0,0 +1,431 @@
+/*
+
+nuple-group: hash group-by and aggregation over vectors of nuples (C++14)
+
+License: Public-domain software
+
+Description:
+
+  group_by< key names... >( rows ).agg( aggregates... ) groups nuple rows by the key fields
+  and returns a std::vector of result nuples, one per group. The result type is computed at
+  compile time: key names and types first, then one member per aggregate:
+
+    sum< $("qty") > -> $("sum_qty"), type of qty
+    min< $("px") >  -> $("min_px"), type of px
+    max< $("px") >  -> $("max_px"), type of px
+    count           -> $("count"), std::uint64_t
+
+  Groups are found with an open-addressing table (hash and group id per slot, linear
+  probing). Group keys are kept in one array and every aggregate in its own array
+  (structure of arrays), so the table itself stays small and dense. Rows are processed in
+  batches: hashes for the batch first, then the probes. Keys are hashed and compared like in
+  nuple-index.h, so string and C string keys are grouped by their characters.
+
+  parallel( n ) partitions groups between n threads by the upper bits of the key hash.
+  Every thread scans the hashes and aggregates only its own groups, so no merging is
+  needed. Groups in the result are in the order of first appearance (per partition
+  in parallel mode).
+
+  Aggregate names are built by prefixing the interned string of the field, this requires
+  N3599 (default on GCC and Clang, see intern.h).
+
+Dependencies:
+
+  nuple.h: nuple, get
+  nuple-index.h: index_hash, index_equal, index_hash_combine, index_hash_final
+  vector: std::vector
+  thread: std::thread
+  cstdint: std::uint32_t, std::uint64_t
+
+Usage:
+
+  #include "nuple-group.h"
+
+  using namespace nuple_ns::agg; //sum, min, max, count
+
+  using fill_t = nuple< $("sym"), std::string, $("qty"), long, $("px"), double >;
+
+  std::vector< fill_t > rows{ ... };
+
+  auto groups = group_by< $("sym") >( rows ).agg( sum< $("qty") >, max< $("px") >, count );
+
+  //std::vector< nuple< $("sym"), std::string, $("sum_qty"), long, $("max_px"), double, $("count"), std::uint64_t > >
+
+  for( auto const & g : groups )
+
+    printf( "%s %ld %f\n", get< $("sym") >( g ).data(), get< $("sum_qty") >( g ), get< $("max_px") >( g ) );
+
+
+  //several key fields, four threads
+
+  auto by_day = group_by< $("sym"), $("day") >( rows ).parallel( 4 ).agg( count );
+
+*/
+
+#ifndef NUPLE_GROUP_H
+#define NUPLE_GROUP_H
+
+#include <vector>
+#include <thread>
+#include <cstdint>
+
+#include "nuple.h"
+#include "nuple-index.h"
+
+
+namespace nuple_ns {
+
+
+  //aggregates: name - result member name, type<R> - accumulator type,
+  //init( row ) - value for the first row of a group, update( acc, row ) - the rest
+
+  namespace agg {
+
+    template<typename F> struct agg_sum;
+    template<typename F> struct agg_min;
+    template<typename F> struct agg_max;
+
+    template<char... CC> struct agg_sum< intern::string<CC...> > {
+
+      using name = intern::string< 's', 'u', 'm', '_', CC... >;
+
+      template<typename R>
+      using type = std::decay_t< decltype( get< intern::string<CC...> >( std::declval<R const &>() ) ) >;
+
+      template<typename R>
+      static type<R> init ( R const & r ) { return get< intern::string<CC...> >( r ); }
+
+      template<typename A, typename R>
+      static void update ( A & a, R const & r ) { a += get< intern::string<CC...> >( r ); }
+    };
+
+    template<char... CC> struct agg_min< intern::string<CC...> > {
+
+      using name = intern::string< 'm', 'i', 'n', '_', CC... >;
+
+      template<typename R>
+      using type = std::decay_t< decltype( get< intern::string<CC...> >( std::declval<R const &>() ) ) >;
+
+      template<typename R>
+      static type<R> init ( R const & r ) { return get< intern::string<CC...> >( r ); }
+
+      template<typename A, typename R>
+      static void update ( A & a, R const & r ) {
+
+        auto const & v = get< intern::string<CC...> >( r );
+
+        if( v < a ) a = v;
+      }
+    };
+
+    template<char... CC> struct agg_max< intern::string<CC...> > {
+
+      using name = intern::string< 'm', 'a', 'x', '_', CC... >;
+
+      template<typename R>
+      using type = std::decay_t< decltype( get< intern::string<CC...> >( std::declval<R const &>() ) ) >;
+
+      template<typename R>
+      static type<R> init ( R const & r ) { return get< intern::string<CC...> >( r ); }
+
+      template<typename A, typename R>
+      static void update ( A & a, R const & r ) {
+
+        auto const & v = get< intern::string<CC...> >( r );
+
+        if( a < v ) a = v;
+      }
+    };
+
+    struct agg_count {
+
+      using name = $("count");
+
+      template<typename R>
+      using type = std::uint64_t;
+
+      template<typename R>
+      static type<R> init ( R const & ) { return 1; }
+
+      template<typename A, typename R>
+      static void update ( A & a, R const & ) { a++; }
+    };
+
+    template<typename F> constexpr agg_sum<F> sum{};
+    template<typename F> constexpr agg_min<F> min{};
+    template<typename F> constexpr agg_max<F> max{};
+
+    constexpr agg_count count{};
+  }
+
+
+  //result row: nuple< key name, key type, ..., aggregate name, aggregate type, ... >
+
+  template<typename N, typename T, typename O = luple_ns::type_list<>> struct as_nuple_t;
+
+  template<typename N, typename... NN, typename T, typename... TT, typename... OO>
+  struct as_nuple_t< luple_ns::type_list<N, NN...>, luple_ns::type_list<T, TT...>, luple_ns::type_list<OO...> > :
+    as_nuple_t< luple_ns::type_list<NN...>, luple_ns::type_list<TT...>, luple_ns::type_list<OO..., N, T> > {};
+
+  template<typename... OO>
+  struct as_nuple_t< luple_ns::type_list<>, luple_ns::type_list<>, luple_ns::type_list<OO...> > {
+
+    using type = nuple<OO...>;
+  };
+
+  template<typename R, typename K, typename... AA> struct group_row;
+
+  template<typename R, typename... KK, typename... AA> struct group_row< R, luple_ns::type_list<KK...>, AA... > {
+
+    using type = typename as_nuple_t< 
+      luple_ns::type_list< KK..., typename AA::name... >,
+      luple_ns::type_list< std::decay_t< decltype( get<KK>( std::declval<R const &>() ) ) >..., typename AA::template type<R>... > 
+    >::type;
+  };
+
+  template<typename R, typename K, typename... AA>
+  using group_row_t = typename group_row< R, K, AA... >::type;
+
+
+  //hash table of groups, keys and accumulators are stored column-wise
+
+  template<typename R, typename K, typename... AA> struct group_table;
+
+  template<typename R, typename... KK, typename... AA> struct group_table< R, luple_ns::type_list<KK...>, AA... > {
+
+    using key_t = luple< std::decay_t< decltype( get<KK>( std::declval<R const &>() ) ) >... >;
+    using result_t = group_row_t< R, luple_ns::type_list<KK...>, AA... >;
+
+    static const int empty = -1;
+
+    struct slot {
+
+      std::uint32_t hash;
+      int group;
+    };
+
+    group_table () : _slots( 64, slot{ 0, empty } ) {}
+
+
+    static std::uint32_t hash ( R const & r ) {
+
+      std::uint64_t h = 0;
+
+      char dummy[] = { ( h = index_hash_combine( h, index_hash< std::decay_t< decltype( get<KK>( r ) ) > >{}( get<KK>( r ) ) ), char{} )... };
+      (void) dummy;
+
+      return index_hash_final( h );
+    }
+
+
+    //add a row with a precomputed hash
+
+    void add ( R const & r, std::uint32_t h ) {
+
+      std::size_t mask = _slots.size() - 1;
+
+      for( std::size_t i = h & mask; ; i = ( i + 1 ) & mask ) {
+
+        int g = _slots[ i ].group;
+
+        if( g == empty ) {
+
+          _slots[ i ] = slot{ h, (int) _keys.size() };
+          _keys.push_back( key_t{ get<KK>( r )... } );
+          init_( r, std::make_integer_sequence< int, sizeof...(AA) >{} );
+
+          if( _keys.size() * 2 > _slots.size() ) grow();
+
+          return;
+        }
+
+        if( _slots[ i ].hash == h && equal_( _keys[ g ], r, std::make_integer_sequence< int, sizeof...(KK) >{} ) ) {
+
+          update_( g, r, std::make_integer_sequence< int, sizeof...(AA) >{} );
+
+          return;
+        }
+      }
+    }
+
+
+    //append groups to the output
+
+    void result ( std::vector< result_t > & out ) const {
+
+      for( std::size_t g = 0; g < _keys.size(); ++g ) {
+
+        out.emplace_back();
+
+        result_( out.back(), g, std::make_integer_sequence< int, sizeof...(KK) >{}, std::make_integer_sequence< int, sizeof...(AA) >{} );
+      }
+    }
+
+  private:
+
+    template<int... NN>
+    static bool equal_ ( key_t const & k, R const & r, std::integer_sequence<int, NN...> ) {
+
+      bool equal = true;
+
+      char dummy[] = { ( equal = equal && index_equal( get<NN>( k ), get<KK>( r ) ), char{} )... };
+      (void) dummy;
+
+      return equal;
+    }
+
+    template<int... NN>
+    void init_ ( R const & r, std::integer_sequence<int, NN...> ) {
+
+      char dummy[] = { ( get<NN>( _accs ).push_back( AA::init( r ) ), char{} )..., char{} };
+      (void) dummy;
+    }
+
+    template<int... NN>
+    void update_ ( int g, R const & r, std::integer_sequence<int, NN...> ) {
+
+      char dummy[] = { ( AA::update( get<NN>( _accs )[ g ], r ), char{} )..., char{} };
+      (void) dummy;
+    }
+
+    template<int... NN, int... MM>
+    void result_ ( result_t & o, std::size_t g, std::integer_sequence<int, NN...>, std::integer_sequence<int, MM...> ) const {
+
+      char dummy[] = {
+        ( get< NN >( o ) = get< NN >( _keys[ g ] ), char{} )...,
+        ( get< sizeof...(KK) + MM >( o ) = get< MM >( _accs )[ g ], char{} )..., char{} };
+      (void) dummy;
+    }
+
+    void grow () {
+
+      std::vector< slot > old( _slots.size() * 2, slot{ 0, empty } );
+
+      old.swap( _slots );
+
+      std::size_t mask = _slots.size() - 1;
+
+      for( auto const & s : old ) {
+
+        if( s.group == empty ) continue;
+
+        std::size_t i = s.hash & mask;
+
+        while( _slots[ i ].group != empty ) i = ( i + 1 ) & mask;
+
+        _slots[ i ] = s;
+      }
+    }
+
+    std::vector< slot > _slots;
+    std::vector< key_t > _keys;
+    luple< std::vector< typename AA::template type<R> >... > _accs;
+  };
+
+
+  //group_by< key names... >( rows )
+
+  template<typename R, typename... KK>
+  struct grouper {
+
+    static const int batch = 256;
+
+    grouper ( R const * rows, std::size_t size ) : _rows{ rows }, _size{ size } {}
+
+    //number of threads, partitions of the groups
+    grouper parallel ( int threads ) const {
+
+      grouper g{ *this };
+
+      g._threads = threads < 1 ? 1 : threads;
+
+      return g;
+    }
+
+    template<typename... AA>
+    auto agg ( AA... ) const {
+
+      using table_t = group_table< R, luple_ns::type_list<KK...>, AA... >;
+
+      std::vector< typename table_t::result_t > out;
+
+      if( _threads == 1 ) {
+
+        table_t table;
+        std::uint32_t hashes[ batch ];
+
+        for( std::size_t b = 0; b < _size; b += batch ) {
+
+          std::size_t n = _size - b < batch ? _size - b : batch;
+
+          for( std::size_t i = 0; i < n; ++i ) hashes[ i ] = table_t::hash( _rows[ b + i ] );
+
+          for( std::size_t i = 0; i < n; ++i ) table.add( _rows[ b + i ], hashes[ i ] );
+        }
+
+        table.result( out );
+
+        return out;
+      }
+
+      std::vector< std::uint32_t > hashes( _size );
+      std::vector< table_t > tables( _threads );
+      std::vector< std::thread > threads;
+
+      std::size_t chunk = ( _size + _threads - 1 ) / _threads;
+
+      //hashes in contiguous chunks
+      for( int t = 0; t < _threads; ++t )
+
+        threads.emplace_back( [&, t] {
+
+          std::size_t end = chunk * ( t + 1 ) < _size ? chunk * ( t + 1 ) : _size;
+
+          for( std::size_t i = chunk * t; i < end; ++i ) hashes[ i ] = table_t::hash( _rows[ i ] );
+        } );
+
+      for( auto & t : threads ) t.join();
+
+      threads.clear();
+
+      //groups partitioned by the upper bits of the hash, the table uses the lower ones
+      for( int t = 0; t < _threads; ++t )
+
+        threads.emplace_back( [&, t] {
+
+          for( std::size_t i = 0; i < _size; ++i )
+
+            if( int( std::uint64_t( hashes[ i ] ) * _threads >> 32 ) == t ) tables[ t ].add( _rows[ i ], hashes[ i ] );
+        } );
+
+      for( auto & t : threads ) t.join();
+
+      for( auto const & t : tables ) t.result( out );
+
+      return out;
+    }
+
+  private:
+
+    R const * _rows;
+    std::size_t _size;
+    int _threads = 1;
+  };
+
+
+  template<typename... KK, typename R>
+  auto group_by ( std::vector<R> const & rows ) {
+
+    static_assert( sizeof...(KK) > 0, "group_by needs at least one key field" );
+
+    return grouper< R, KK... >{ rows.data(), rows.size() };
+  }
+
+}
+
+
+//import into global namespace
+
+using nuple_ns::group_by;
+
+#endif // NUPLE_GROUP_H
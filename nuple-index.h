@@ -0,0 +1,421 @@
+/*
+
+nuple-index: secondary hash indexes on vectors of nuples (C++14)
+
+License: Public-domain software
+
+Description:
+
+  A nuple_index maps the values of one or several named fields of a nuple to row ids
+  (positions in a std::vector of nuples). It's an open-addressing flat hash with linear
+  probing: a slot is a 32-bit hash and a row id, 8 bytes, and erasing uses backward shift
+  so there are no tombstones. Keys don't have to be unique, equal keys are found by probing.
+
+  The index doesn't own the rows. It's kept up to date incrementally: call insert after a
+  row was added, erase before a row is removed or its key fields are changed (and insert
+  after the change), relocate when a row is moved to another position.
+
+  Lookups take a luple of the key values, use luple_tie to avoid building a temporary.
+  Key members are hashed with std::hash of the field type, except strings: a basic_string
+  field (any allocator) or a string_view field is hashed by its characters, and so are the
+  keys looked up in it, so a std::string field can be found with a std::string_view or a
+  char const * key without building a temporary string. C string fields (char const *) are
+  hashed and compared by their characters too, not by the pointer.
+
+Dependencies:
+
+  nuple.h: nuple, luple, luple_tie
+  vector: std::vector
+  functional: std::hash
+  string, string_view (C++17): string fields
+  cstring, cstdint: std::strlen, std::strcmp, std::uint32_t, std::uint64_t
+  type_traits: std::is_same, std::decay_t
+
+Usage:
+
+  #include "nuple-index.h"
+
+  using order_t = nuple< $("order_id"), int, $("sym"), std::string, $("ts"), long >;
+
+  std::vector< order_t > rows{ { 1, "abc", 100 }, { 2, "xyz", 100 } };
+
+  auto by_id = make_index< $("order_id") >( rows ); //nuple_index< order_t, $("order_id") >
+
+  auto by_sym_ts = make_index< $("sym"), $("ts") >( rows ); //composite key
+
+
+  int id = 2;
+
+  int row = by_id.find( luple_tie( id ) ); //row id or -1, also by_id.find( 2 )
+
+  by_sym_ts.find_all( luple_tie( sym, ts ), []( int row ) { ... } ); //all rows with the key
+
+
+  //maintenance
+
+  rows.push_back( { 3, "abc", 200 } );
+  by_id.insert( rows.size() - 1 );
+
+  by_id.erase( 0 ); //before changing a key field
+  get< $("order_id") >( rows[0] ) = 10;
+  by_id.insert( 0 );
+
+  by_id.erase( 1 ); //swap and pop: erase, move the last row and relocate it
+  rows[1] = std::move( rows.back() );
+  rows.pop_back();
+  by_id.relocate( rows.size(), 1 );
+
+*/
+
+#ifndef NUPLE_INDEX_H
+#define NUPLE_INDEX_H
+
+#include <vector>
+#include <functional>
+#include <string>
+#include <cstring>
+#include <cstdint>
+#include <type_traits>
+
+#if __cplusplus >= 201703L
+  #include <string_view>
+#endif
+
+#include "nuple.h"
+
+
+namespace nuple_ns {
+
+
+  //hashing of key fields
+
+  inline std::uint64_t index_hash_combine ( std::uint64_t h, std::uint64_t v ) {
+
+    return ( h ^ v ) * 0x9E3779B97F4A7C15ull;
+  }
+
+  //the upper bits are the best mixed
+  inline std::uint32_t index_hash_final ( std::uint64_t h ) {
+
+    return std::uint32_t( ( h ^ ( h >> 29 ) ) >> 32 );
+  }
+
+  inline std::uint64_t index_hash_chars ( char const * p, std::size_t n ) {
+
+    std::uint64_t h = n;
+
+    for( ; n >= 8; p += 8, n -= 8 ) {
+
+      std::uint64_t v;
+
+      std::memcpy( &v, p, 8 );
+
+      h = index_hash_combine( h, v );
+    }
+
+    std::uint64_t tail = 0;
+
+    std::memcpy( &tail, p, n );
+
+    return index_hash_combine( h, tail ) ^ ( h >> 31 );
+  }
+
+  //string keys: anything with data() and size(), C strings
+
+  template<typename S>
+  auto index_hash_string ( S const & s ) -> decltype( index_hash_chars( s.data(), s.size() ) ) {
+
+    return index_hash_chars( s.data(), s.size() );
+  }
+
+  inline std::uint64_t index_hash_string ( char const * s ) { return index_hash_chars( s, std::strlen( s ) ); }
+
+
+  //hash of a key field of type T, V is the type of the value (the field or a lookup key)
+
+  template<typename T> struct index_hash {
+
+    template<typename V>
+    std::uint64_t operator() ( V const & v ) const { return std::hash< T >{}( v ); }
+  };
+
+  struct index_hash_str {
+
+    template<typename V>
+    std::uint64_t operator() ( V const & v ) const { return index_hash_string( v ); }
+  };
+
+  template<typename Tr, typename A> struct index_hash< std::basic_string< char, Tr, A > > : index_hash_str {};
+  template<> struct index_hash< char const * > : index_hash_str {};
+  template<> struct index_hash< char * > : index_hash_str {};
+
+#if __cplusplus >= 201703L
+  template<typename Tr> struct index_hash< std::basic_string_view< char, Tr > > : index_hash_str {};
+#endif
+
+
+  //equality of key fields, C strings are compared by their characters like they are hashed
+
+  template<typename T> using index_is_cstr = std::integral_constant< bool, std::is_same< std::decay_t<T>, char const * >::value || std::is_same< std::decay_t<T>, char * >::value >;
+
+  template<typename A, typename B>
+  bool index_equal_ ( A const & a, B const & b, std::false_type ) { return a == b; }
+
+  inline bool index_equal_ ( char const * a, char const * b, std::true_type ) { return std::strcmp( a, b ) == 0; }
+
+  template<typename A, typename B>
+  bool index_equal ( A const & a, B const & b ) {
+
+    return index_equal_( a, b, std::integral_constant< bool, index_is_cstr<A>::value && index_is_cstr<B>::value >{} );
+  }
+
+
+  //R - row type (nuple), NN... - names of key fields
+
+  template<typename R, typename... NN>
+  struct nuple_index {
+
+    static_assert( sizeof...(NN) > 0, "nuple_index needs at least one key field" );
+
+    using row_type = R;
+
+    //types of the key fields
+    using key_list = luple_ns::type_list< std::decay_t< decltype( get<NN>( std::declval<R const &>() ) ) >... >;
+
+    static const int empty = -1;
+
+    struct slot {
+
+      std::uint32_t hash;
+      int row;
+    };
+
+
+    nuple_index ( std::vector<R> const & rows ) : _rows{ &rows } {
+
+      rebuild();
+    }
+
+
+    //drop everything and index all rows
+
+    void rebuild () {
+
+      _slots.assign( capacity_for( _rows->size() ), slot{ 0, empty } );
+      _size = 0;
+
+      for( int i = 0; i < (int) _rows->size(); ++i ) insert( i );
+    }
+
+
+    //row was added or its key fields were changed
+
+    void insert ( int row ) {
+
+      if( ( _size + 1 ) * 2 > _slots.size() ) grow();
+
+      std::uint32_t h = hash_row( (*_rows)[ row ] );
+      std::size_t i = h & mask();
+
+      while( _slots[ i ].row != empty ) i = ( i + 1 ) & mask();
+
+      _slots[ i ] = slot{ h, row };
+      _size++;
+    }
+
+
+    //call before the row is removed or its key fields are changed
+
+    void erase ( int row ) {
+
+      std::size_t i = find_slot( (*_rows)[ row ], row );
+
+      if( i == npos ) return;
+
+      //backward shift: move up entries that probed past the freed slot
+      for( std::size_t j = ( i + 1 ) & mask(); _slots[ j ].row != empty; j = ( j + 1 ) & mask() ) {
+
+        std::size_t home = _slots[ j ].hash & mask();
+
+        bool movable = i <= j ? ( home <= i || home > j ) : ( home <= i && home > j );
+
+        if( movable ) {
+
+          _slots[ i ] = _slots[ j ];
+          i = j;
+        }
+      }
+
+      _slots[ i ].row = empty;
+      _size--;
+    }
+
+
+    //the row was moved from position 'from' to 'to', rows[ to ] holds it now
+
+    void relocate ( int from, int to ) {
+
+      std::size_t i = find_slot( (*_rows)[ to ], from );
+
+      if( i != npos ) _slots[ i ].row = to;
+    }
+
+
+    //first row with the key or -1, key is a luple ( luple_tie ) of key values
+
+    template<typename K>
+    int find ( luple_t<K> const & key ) const {
+
+      int r = empty;
+
+      find_( key, [&r]( int row ) { r = row; return false; } );
+
+      return r;
+    }
+
+    template<typename... KK>
+    int find ( KK const &... keys ) const {
+
+      return find( luple< KK const &... >{ keys... } );
+    }
+
+
+    //calls fn( row ) for every row with the key
+
+    template<typename K, typename F>
+    void find_all ( luple_t<K> const & key, F fn ) const {
+
+      find_( key, [&fn]( int row ) { fn( row ); return true; } );
+    }
+
+
+    auto size () const { return _size; }
+
+    auto capacity () const { return _slots.size(); }
+
+
+  private:
+
+    static const std::size_t npos = ~std::size_t{};
+
+    template<int... II>
+    static std::uint32_t hash_row_ ( R const & r, std::integer_sequence<int, II...> ) {
+
+      std::uint64_t h = 0;
+
+      char dummy[] = { ( h = index_hash_combine( h, index_hash< luple_ns::tlist_get_t< key_list, II > >{}( get<NN>( r ) ) ), char{} )... };
+      (void) dummy;
+
+      return index_hash_final( h );
+    }
+
+    static std::uint32_t hash_row ( R const & r ) {
+
+      return hash_row_( r, std::make_integer_sequence< int, sizeof...(NN) >{} );
+    }
+
+    template<typename K, int... II>
+    static std::uint32_t hash_key_ ( luple_t<K> const & k, std::integer_sequence<int, II...> ) {
+
+      std::uint64_t h = 0;
+
+      char dummy[] = { ( h = index_hash_combine( h, index_hash< luple_ns::tlist_get_t< key_list, II > >{}( get<II>( k ) ) ), char{} )... };
+      (void) dummy;
+
+      return index_hash_final( h );
+    }
+
+    template<typename K, int... II>
+    static bool equal_ ( luple_t<K> const & k, R const & r, std::integer_sequence<int, II...> ) {
+
+      bool equal = true;
+
+      char dummy[] = { ( equal = equal && index_equal( get<II>( k ), get<NN>( r ) ), char{} )... };
+      (void) dummy;
+
+      return equal;
+    }
+
+    //fn returns false to stop
+    template<typename K, typename F>
+    void find_ ( luple_t<K> const & key, F fn ) const {
+
+      static_assert( K::size == sizeof...(NN), "wrong number of key fields" );
+
+      using seq = std::make_integer_sequence< int, sizeof...(NN) >;
+
+      std::uint32_t h = hash_key_( key, seq{} );
+
+      for( std::size_t i = h & mask(); _slots[ i ].row != empty; i = ( i + 1 ) & mask() ) {
+
+        if( _slots[ i ].hash == h && equal_( key, (*_rows)[ _slots[ i ].row ], seq{} ) )
+
+          if( ! fn( _slots[ i ].row ) ) return;
+      }
+    }
+
+    //slot of the row, key is read from r
+    std::size_t find_slot ( R const & r, int row ) const {
+
+      std::uint32_t h = hash_row( r );
+
+      for( std::size_t i = h & mask(); _slots[ i ].row != empty; i = ( i + 1 ) & mask() )
+
+        if( _slots[ i ].row == row ) return i;
+
+      return npos;
+    }
+
+    void grow () {
+
+      std::vector< slot > old( _slots.size() * 2, slot{ 0, empty } );
+
+      old.swap( _slots );
+
+      for( auto const & s : old ) {
+
+        if( s.row == empty ) continue;
+
+        std::size_t i = s.hash & mask();
+
+        while( _slots[ i ].row != empty ) i = ( i + 1 ) & mask();
+
+        _slots[ i ] = s;
+      }
+    }
+
+    //power of two, load factor of at most 1/2
+    static std::size_t capacity_for ( std::size_t n ) {
+
+      std::size_t c = 16;
+
+      while( c < n * 2 ) c *= 2;
+
+      return c;
+    }
+
+    std::size_t mask () const { return _slots.size() - 1; }
+
+    std::vector<R> const * _rows;
+    std::vector< slot > _slots;
+    std::size_t _size = 0;
+  };
+
+
+  //make_index< $("name"), ... >( rows ) -> nuple_index< row type, $("name"), ... >
+
+  template<typename... NN, typename R>
+  auto make_index ( std::vector<R> const & rows ) {
+
+    return nuple_index< R, NN... >{ rows };
+  }
+
+}
+
+
+//import into global namespace
+
+using nuple_ns::nuple_index;
+using nuple_ns::make_index;
+
+#endif // NUPLE_INDEX_H
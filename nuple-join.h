@@ -0,0 +1,450 @@
+/*
+
+nuple-join: hash and sort-merge joins of nuple tables on named keys (C++14)
+
+License: Public-domain software
+
+Description:
+
+  hash_join< key names... >( left, right ) and merge_join< key names... >( left, right ) are
+  inner joins of two std::vector's of nuples on equal key fields. Every matching pair gives
+  one result row (many-to-many keys give all pairs). The result type is computed at compile
+  time: all members of the left row, then the members of the right row without the key
+  fields. A right member whose name is already taken gets a right_ prefix:
+
+    nuple< $("order_id"), int, $("px"), double >
+    nuple< $("fill_id"), int, $("order_id"), int, $("px"), double >
+
+    -> nuple< $("order_id"), int, $("px"), double, $("fill_id"), int, $("right_px"), double >
+
+  hash_join builds on the right side: its rows are partitioned by the upper bits of the key
+  hash and every partition (NUPLE_JOIN_PARTITION rows) gets its own cache-sized table. Left
+  rows are read in order and probed in batches: the slots of a batch are prefetched first,
+  then the first matching right rows, then the batch is probed. Put the smaller table on the
+  right. With threads > 1 partitions are built in parallel and every thread probes its own
+  range of left rows. Result rows follow the order of the left rows.
+
+  merge_join expects both sides sorted by the key fields (operator<) and keeps that order.
+
+  hash_join hashes and compares key fields like nuple-index.h: strings, string views and
+  C strings by their characters (a std::string key matches a char const * key), other
+  types with std::hash, so on both sides they should have types that hash equally.
+  Prefixing names requires N3599 (default on GCC and Clang, see intern.h).
+
+Dependencies:
+
+  nuple.h: nuple, get, luple_tie
+  nuple-group.h: as_nuple_t
+  nuple-index.h: index_hash, index_equal, index_hash_combine, index_hash_final
+  vector, thread, atomic, algorithm, iterator, functional, cstdint
+
+Usage:
+
+  #include "nuple-join.h"
+
+  using order_t = nuple< $("order_id"), int, $("sym"), std::string, $("px"), double >;
+  using fill_t = nuple< $("fill_id"), int, $("order_id"), int, $("px"), double, $("qty"), int >;
+
+  std::vector< order_t > orders{ ... };
+  std::vector< fill_t > fills{ ... };
+
+  auto rows = hash_join< $("order_id") >( orders, fills );
+
+  //std::vector< nuple< $("order_id"), int, $("sym"), std::string, $("px"), double,
+  //                    $("fill_id"), int, $("right_px"), double, $("qty"), int > >
+
+  for( auto const & r : rows ) slippage += get< $("right_px") >( r ) - get< $("px") >( r );
+
+
+  auto rows4 = hash_join< $("order_id") >( orders, fills, 4 ); //four threads
+
+  auto sorted = merge_join< $("order_id") >( orders_by_id, fills_by_order_id );
+
+  using row_t = join_row_t< order_t, fill_t, luple_ns::type_list< $("order_id") > >;
+
+*/
+
+#ifndef NUPLE_JOIN_H
+#define NUPLE_JOIN_H
+
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <iterator>
+#include <functional>
+#include <cstdint>
+
+#include "nuple.h"
+#include "nuple-index.h"
+#include "nuple-group.h"
+
+
+namespace nuple_ns {
+
+
+  //right rows in a partition of hash_join, the hash table has twice as many slots
+
+  #ifndef NUPLE_JOIN_PARTITION
+    #define NUPLE_JOIN_PARTITION 4096
+  #endif
+
+
+  //a right side name that is already taken gets a right_ prefix (again if needed)
+
+  template<typename N> struct join_prefix;
+
+  template<char... CC> struct join_prefix< intern::string<CC...> > {
+
+    using type = intern::string< 'r', 'i', 'g', 'h', 't', '_', CC... >;
+  };
+
+  template<typename NL, typename N, bool = ( luple_ns::tlist_get_n< NL, N >::value != -1 )> struct join_name {
+
+    using type = N;
+  };
+
+  template<typename NL, typename N> struct join_name< NL, N, true > : join_name< NL, typename join_prefix<N>::type > {};
+
+
+  //right side members of a result row: names, types and indices in the right row, key fields are dropped
+  //LN - left names, KL - key names, RN/RT - right names/types, I - current index
+
+  template<typename LN, typename KL, typename RN, typename RT, int I = 0,
+           typename ON = luple_ns::type_list<>, typename OT = luple_ns::type_list<>, typename OI = std::integer_sequence<int>>
+  struct join_right;
+
+  template<typename LN, typename KL, typename N, typename... NN, typename T, typename... TT, int I, typename... ON, typename... OT, int... OI>
+  struct join_right< LN, KL, luple_ns::type_list<N, NN...>, luple_ns::type_list<T, TT...>, I,
+                     luple_ns::type_list<ON...>, luple_ns::type_list<OT...>, std::integer_sequence<int, OI...> > :
+
+    std::conditional_t< luple_ns::tlist_get_n< KL, N >::value != -1,
+
+      join_right< LN, KL, luple_ns::type_list<NN...>, luple_ns::type_list<TT...>, I + 1,
+                  luple_ns::type_list<ON...>, luple_ns::type_list<OT...>, std::integer_sequence<int, OI...> >,
+
+      join_right< LN, KL, luple_ns::type_list<NN...>, luple_ns::type_list<TT...>, I + 1,
+                  luple_ns::type_list<ON..., typename join_name< luple_ns::tlist_cat_t< LN, luple_ns::type_list<ON...> >, N >::type>,
+                  luple_ns::type_list<OT..., T>, std::integer_sequence<int, OI..., I> > > {};
+
+  template<typename LN, typename KL, int I, typename ON, typename OT, typename OI>
+  struct join_right< LN, KL, luple_ns::type_list<>, luple_ns::type_list<>, I, ON, OT, OI > {
+
+    using names = ON;
+    using types = OT;
+    using index = OI;
+  };
+
+
+  //result row of a join: members of the left row, then right members that are not keys
+
+  template<typename L, typename R, typename K> struct join_row;
+
+  template<typename L, typename R, typename... KK> struct join_row< L, R, luple_ns::type_list<KK...> > {
+
+    using right = join_right< typename L::name_list, luple_ns::type_list<KK...>, typename R::name_list, typename R::type_list >;
+
+    using type = typename as_nuple_t<
+      luple_ns::tlist_cat_t< typename L::name_list, typename right::names >,
+      luple_ns::tlist_cat_t< typename L::type_list, typename right::types >
+    >::type;
+
+    static type make ( L const & l, R const & r ) {
+
+      return make_( l, r, std::make_integer_sequence< int, L::size >{}, typename right::index{} );
+    }
+
+  private:
+
+    template<int... LI, int... RI>
+    static type make_ ( L const & l, R const & r, std::integer_sequence<int, LI...>, std::integer_sequence<int, RI...> ) {
+
+      return type{ get<LI>( l )..., get<RI>( r )... };
+    }
+  };
+
+  template<typename L, typename R, typename K>
+  using join_row_t = typename join_row< L, R, K >::type;
+
+
+  //key helpers
+
+  template<typename... KK, typename T>
+  std::uint32_t join_hash ( T const & r ) {
+
+    std::uint64_t h = 0;
+
+    char dummy[] = { ( h = index_hash_combine( h, index_hash< std::decay_t< decltype( get<KK>( r ) ) > >{}( get<KK>( r ) ) ), char{} )... };
+    (void) dummy;
+
+    return index_hash_final( h );
+  }
+
+  template<typename... KK, typename L, typename R>
+  bool join_equal ( L const & l, R const & r ) {
+
+    bool equal = true;
+
+    char dummy[] = { ( equal = equal && index_equal( get<KK>( l ), get<KK>( r ) ), char{} )... };
+    (void) dummy;
+
+    return equal;
+  }
+
+  inline void join_prefetch ( void const * p ) {
+
+  #if defined( __GNUC__ ) || defined( __clang__ )
+    __builtin_prefetch( p );
+  #else
+    (void) p;
+  #endif
+  }
+
+
+  //partitioned hash join, see hash_join
+
+  template<typename L, typename R, typename... KK>
+  struct hash_joiner {
+
+    using row = join_row< L, R, luple_ns::type_list<KK...> >;
+    using result_t = typename row::type;
+
+    //left rows probed together: slots of the batch are prefetched, then the first matching right rows
+    static const int batch = 16;
+
+    static const int empty = -1;
+
+    struct slot {
+
+      std::uint32_t hash;
+      int row;
+    };
+
+    hash_joiner ( L const * left, std::size_t left_size, R const * right, std::size_t right_size, int threads ) :
+
+      _left{ left }, _right{ right }, _left_size{ left_size }, _right_size{ right_size }, _threads{ threads < 1 ? 1 : threads } {
+
+      while( _bits < 16 && ( _right_size >> _bits ) > NUPLE_JOIN_PARTITION ) ++_bits;
+    }
+
+    std::vector< result_t > run () {
+
+      build_();
+
+      std::vector< std::vector< result_t > > outs( _threads );
+
+      std::size_t chunk = ( _left_size + _threads - 1 ) / _threads;
+
+      parallel_( [&]( int t ) { probe_( std::min( _left_size, chunk * t ), std::min( _left_size, chunk * ( t + 1 ) ), outs[ t ] ); } );
+
+      if( _threads == 1 ) return std::move( outs[ 0 ] );
+
+      std::size_t size = 0;
+
+      for( auto const & o : outs ) size += o.size();
+
+      std::vector< result_t > out;
+
+      out.reserve( size );
+
+      for( auto & o : outs ) out.insert( out.end(), std::make_move_iterator( o.begin() ), std::make_move_iterator( o.end() ) );
+
+      return out;
+    }
+
+  private:
+
+    //f( thread ) on every thread
+    template<typename F>
+    void parallel_ ( F && f ) const {
+
+      if( _threads == 1 ) { f( 0 ); return; }
+
+      std::vector< std::thread > threads;
+
+      for( int t = 0; t < _threads; ++t ) threads.emplace_back( f, t );
+
+      for( auto & t : threads ) t.join();
+    }
+
+    int partition_of_ ( std::uint32_t h ) const { return _bits ? int( h >> ( 32 - _bits ) ) : 0; }
+
+    //right rows are sorted into partitions by the upper bits of the hash, every partition gets
+    //its own table (the lower bits) in one array of slots
+    void build_ () {
+
+      std::vector< std::uint32_t > hashes( _right_size );
+
+      std::size_t chunk = ( _right_size + _threads - 1 ) / _threads;
+
+      parallel_( [&]( int t ) {
+
+        for( std::size_t i = chunk * t; i < std::min( _right_size, chunk * ( t + 1 ) ); ++i ) hashes[ i ] = join_hash< KK... >( _right[ i ] );
+      } );
+
+      int parts = 1 << _bits;
+
+      std::vector< std::size_t > offsets( parts + 1, 0 );
+
+      for( auto h : hashes ) offsets[ partition_of_( h ) + 1 ]++;
+
+      for( int i = 0; i < parts; ++i ) offsets[ i + 1 ] += offsets[ i ];
+
+      std::vector< int > rows( _right_size );
+      std::vector< std::size_t > pos( offsets.begin(), offsets.end() - 1 );
+
+      for( std::size_t i = 0; i < _right_size; ++i ) rows[ pos[ partition_of_( hashes[ i ] ) ]++ ] = int( i );
+
+      _tables.assign( parts + 1, 0 );
+      _masks.assign( parts, 0 );
+
+      for( int p = 0; p < parts; ++p ) {
+
+        std::size_t size = 16;
+
+        while( size < ( offsets[ p + 1 ] - offsets[ p ] ) * 2 ) size *= 2;
+
+        _tables[ p + 1 ] = _tables[ p ] + size;
+        _masks[ p ] = size - 1;
+      }
+
+      _slots.assign( _tables[ parts ], slot{ 0, empty } );
+
+      //partitions are built in parallel, a row keeps its order in the probe chain
+      parallel_( [&]( int t ) {
+
+        for( int p = t; p < parts; p += _threads ) {
+
+          slot * table = &_slots[ _tables[ p ] ];
+          std::size_t mask = _masks[ p ];
+
+          for( std::size_t i = offsets[ p ]; i < offsets[ p + 1 ]; ++i ) {
+
+            std::uint32_t h = hashes[ rows[ i ] ];
+            std::size_t s = h & mask;
+
+            while( table[ s ].row != empty ) s = ( s + 1 ) & mask;
+
+            table[ s ] = slot{ h, rows[ i ] };
+          }
+        }
+      } );
+    }
+
+    //left rows [ begin, end ) in batches
+    void probe_ ( std::size_t begin, std::size_t end, std::vector< result_t > & out ) const {
+
+      std::uint32_t hashes[ batch ];
+      slot const * tables[ batch ];
+      std::size_t first[ batch ];
+
+      out.reserve( end - begin );
+
+      for( std::size_t b = begin; b < end; b += batch ) {
+
+        std::size_t n = end - b < batch ? end - b : batch;
+
+        for( std::size_t i = 0; i < n; ++i ) {
+
+          hashes[ i ] = join_hash< KK... >( _left[ b + i ] );
+
+          int p = partition_of_( hashes[ i ] );
+
+          tables[ i ] = &_slots[ _tables[ p ] ];
+          first[ i ] = hashes[ i ] & _masks[ p ];
+
+          join_prefetch( &tables[ i ][ first[ i ] ] );
+        }
+
+        for( std::size_t i = 0; i < n; ++i ) {
+
+          slot const & s = tables[ i ][ first[ i ] ];
+
+          if( s.row != empty && s.hash == hashes[ i ] ) join_prefetch( &_right[ s.row ] );
+        }
+
+        for( std::size_t i = 0; i < n; ++i ) {
+
+          slot const * table = tables[ i ];
+          std::size_t mask = _masks[ partition_of_( hashes[ i ] ) ];
+
+          for( std::size_t s = first[ i ]; table[ s ].row != empty; s = ( s + 1 ) & mask )
+
+            if( table[ s ].hash == hashes[ i ] && join_equal< KK... >( _left[ b + i ], _right[ table[ s ].row ] ) )
+
+              out.push_back( row::make( _left[ b + i ], _right[ table[ s ].row ] ) );
+        }
+      }
+    }
+
+    L const * _left;
+    R const * _right;
+    std::size_t _left_size, _right_size;
+    int _threads;
+    int _bits = 0;
+
+    std::vector< slot > _slots;
+    std::vector< std::size_t > _tables; //first slot of every partition
+    std::vector< std::size_t > _masks;
+  };
+
+
+  //hash_join< key names... >( left, right, threads = 1 ) -> std::vector< join_row_t< L, R, type_list< key names... > > >
+
+  template<typename... KK, typename L, typename R>
+  auto hash_join ( std::vector<L> const & left, std::vector<R> const & right, int threads = 1 ) {
+
+    static_assert( sizeof...(KK) > 0, "hash_join needs at least one key field" );
+
+    return hash_joiner< L, R, KK... >{ left.data(), left.size(), right.data(), right.size(), threads }.run();
+  }
+
+
+  //merge_join< key names... >( left, right ), both sorted by the key fields
+
+  template<typename... KK, typename L, typename R>
+  auto merge_join ( std::vector<L> const & left, std::vector<R> const & right ) {
+
+    static_assert( sizeof...(KK) > 0, "merge_join needs at least one key field" );
+
+    using row = join_row< L, R, luple_ns::type_list<KK...> >;
+
+    std::vector< typename row::type > out;
+
+    std::size_t i = 0, j = 0;
+
+    while( i < left.size() && j < right.size() ) {
+
+      auto lkey = luple_tie( get<KK>( left[ i ] )... );
+      auto rkey = luple_tie( get<KK>( right[ j ] )... );
+
+      if( lkey < rkey ) { ++i; continue; }
+      if( rkey < lkey ) { ++j; continue; }
+
+      //runs of equal keys on both sides, all pairs
+      std::size_t iend = i + 1, jend = j + 1;
+
+      while( iend < left.size() && join_equal< KK... >( left[ iend ], right[ j ] ) ) ++iend;
+      while( jend < right.size() && join_equal< KK... >( left[ i ], right[ jend ] ) ) ++jend;
+
+      for( std::size_t a = i; a < iend; ++a )
+
+        for( std::size_t b = j; b < jend; ++b ) out.push_back( row::make( left[ a ], right[ b ] ) );
+
+      i = iend;
+      j = jend;
+    }
+
+    return out;
+  }
+
+}
+
+
+//import into global namespace
+
+using nuple_ns::hash_join;
+using nuple_ns::merge_join;
+using nuple_ns::join_row_t;
+
+#endif // NUPLE_JOIN_H
@@ -0,0 +1,513 @@
+/*
+
+nuple-log: deferred-format binary logging of nuples and luples (C++14)
+
+License: Public-domain software
+
+Description:
+
+  Formatting a log line on a hot thread costs far more than copying the values. logger::log
+  copies the raw bytes of a record (a nuple, a luple or the arguments of a format string)
+  into a ring buffer owned by the calling thread, formatting happens later on another thread.
+
+  A record is a small header ( type id, size ) and the members copied with memcpy, so
+  members must be trivially copyable. Every record type is registered once, on first use:
+  the id refers to a function that decodes and formats records of that type. Nuples are
+  formatted as name=value pairs using the nuple names, luples as a list of values, format
+  strings have their {} replaced by the arguments.
+
+  Every thread has its own single-producer single-consumer ring (NUPLE_LOG_BUFFER bytes).
+  The producer writes the data and publishes it with one release store, the consumer
+  position is read only when the cached copy says the ring is full. A record that doesn't
+  fit is dropped and counted, the hot path never blocks.
+
+  drain() formats all pending records (called by one thread at a time), logger::writer
+  runs it on a background thread and writes the text to a FILE*. Records of different
+  threads are not ordered against each other.
+
+  Member formatting is done by log_format( std::string &, T const & ) overloads,
+  add one for your own types (found by ADL).
+
+Dependencies:
+
+  nuple.h: nuple, name_t, luple, luple_do
+  intern.h: intern::is_string
+  atomic, mutex, thread, chrono, vector, memory, string, cstring, cstdio
+
+Usage:
+
+  #include "nuple-log.h"
+
+  using order_t = nuple< $("id"), int, $("price"), double, $("qty"), int >;
+
+  //hot path
+  nuple_log::log( order_t{ 1, 10.5, 100 } );
+  nuple_log::log( $name("order {} filled at {}"), id, price );
+
+  //background thread, flushes every 10 ms and on destruction
+  nuple_log::writer w{ stderr };
+
+  // id=1 price=10.5 qty=100
+  // order 1 filled at 10.5
+
+  //or format by hand
+  std::string text;
+  nuple_log::drain( text );
+
+  auto lost = nuple_log::dropped(); //records that didn't fit into a ring
+
+  //bench/log-bench.cpp measures the hot path
+
+*/
+
+#ifndef NUPLE_LOG_H
+#define NUPLE_LOG_H
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <vector>
+#include <memory>
+#include <string>
+#include <cstring>
+#include <cstdio>
+#include <cstdint>
+#include <type_traits>
+
+#include "nuple.h"
+
+//size of a per-thread ring in bytes, a power of two
+#ifndef NUPLE_LOG_BUFFER
+#define NUPLE_LOG_BUFFER ( 1 << 20 )
+#endif
+
+
+namespace nuple_ns {
+
+
+  //member formatting
+
+  inline void log_format ( std::string & out, bool v ) { out += v ? "true" : "false"; }
+
+  inline void log_format ( std::string & out, char v ) { out += v; }
+
+  template<typename T>
+  std::enable_if_t< std::is_integral<T>::value > log_format ( std::string & out, T v ) { out += std::to_string( v ); }
+
+  template<typename T>
+  std::enable_if_t< std::is_floating_point<T>::value > log_format ( std::string & out, T v ) {
+
+    char buf[ 32 ];
+
+    out.append( buf, std::snprintf( buf, sizeof( buf ), "%.17g", double( v ) ) );
+  }
+
+  template<typename T>
+  std::enable_if_t< std::is_enum<T>::value > log_format ( std::string & out, T v ) {
+
+    log_format( out, std::underlying_type_t<T>( v ) );
+  }
+
+  template<typename T>
+  void log_format ( std::string & out, T * v ) {
+
+    char buf[ 32 ];
+
+    out.append( buf, std::snprintf( buf, sizeof( buf ), "%p", (void const *) v ) );
+  }
+
+  template<typename T>
+  void log_format ( std::string & out, luple_t<T> const & l );
+
+  template<typename T, int... NN>
+  void log_values_ ( std::string & out, luple_t<T> const & l, std::integer_sequence<int, NN...> ) {
+
+    char dummy[] = { ( out.append( NN ? ", " : "" ), log_format( out, get<NN>( l ) ), char{} )..., char{} };
+    (void) dummy;
+  }
+
+  //nested luples as {...}
+  template<typename T>
+  void log_format ( std::string & out, luple_t<T> const & l ) {
+
+    out += '{';
+
+    log_values_( out, l, std::make_integer_sequence< int, T::size >{} );
+
+    out += '}';
+  }
+
+
+  //number of {} in a format string
+
+  constexpr int log_placeholders ( char const * s ) {
+
+    int n = 0;
+
+    for( ; *s; ++s ) if( s[0] == '{' && s[1] == '}' ) ++n, ++s;
+
+    return n;
+  }
+
+  //append the text up to the next {}, return the position after it
+  inline char const * log_text_ ( std::string & out, char const * s ) {
+
+    char const * p = std::strstr( s, "{}" );
+
+    if( ! p ) p = s + std::strlen( s );
+
+    out.append( s, p );
+
+    return *p ? p + 2 : p;
+  }
+
+
+  //record decoders, format() gets the record data
+
+  template<typename N> struct log_record {
+
+    static void format ( char const * data, std::string & out ) {
+
+      N v;
+
+      std::memcpy( &v, data, sizeof( N ) );
+
+      format_( out, v, std::make_integer_sequence< int, N::size >{} );
+    }
+
+    template<typename T, int... NN>
+    static void format_ ( std::string & out, luple_t<T> const & l, std::integer_sequence<int, NN...> ) {
+
+      log_values_( out, l, std::integer_sequence<int, NN...>{} );
+    }
+
+    template<typename... TT, int... NN>
+    static void format_ ( std::string & out, nuple<TT...> const & n, std::integer_sequence<int, NN...> ) {
+
+      using N_ = nuple<TT...>;
+
+      char dummy[] = { ( out.append( NN ? " " : "" ), out.append( name_t< N_, NN >::value ), out += '=', log_format( out, get<NN>( n ) ), char{} )..., char{} };
+      (void) dummy;
+    }
+  };
+
+  //F - interned format string, L - luple of the arguments
+  template<typename F, typename L> struct log_message {
+
+    static void format ( char const * data, std::string & out ) {
+
+      L v;
+
+      std::memcpy( &v, data, sizeof( L ) );
+
+      format_( out, v, std::make_integer_sequence< int, L::size >{} );
+    }
+
+    template<int... NN>
+    static void format_ ( std::string & out, L const & l, std::integer_sequence<int, NN...> ) {
+
+      char const * s = F::value;
+
+      char dummy[] = { ( s = log_text_( out, s ), log_format( out, get<NN>( l ) ), char{} )..., char{} };
+      (void) dummy;
+
+      out += s;
+    }
+  };
+
+
+  //single producer, single consumer byte ring: [ header, data ] records aligned to 8 bytes
+
+  struct log_ring {
+
+    static const std::uint64_t capacity = NUPLE_LOG_BUFFER;
+
+    static_assert( capacity >= 64 && ( capacity & ( capacity - 1 ) ) == 0, "NUPLE_LOG_BUFFER should be a power of two" );
+
+    struct header {
+
+      std::uint32_t id; //0 - padding up to the end of the buffer
+      std::uint32_t size;
+    };
+
+    static constexpr std::uint64_t record_size ( std::uint64_t size ) { return ( sizeof( header ) + size + 7 ) & ~std::uint64_t{ 7 }; }
+
+    log_ring () : _data{ new char[ capacity ] } {}
+
+
+    //producer
+    template<typename T>
+    bool push ( std::uint32_t id, T const & v ) {
+
+      static_assert( record_size( sizeof( T ) ) <= capacity / 2, "a log record is too big for NUPLE_LOG_BUFFER" );
+
+      const std::uint64_t size = record_size( sizeof( T ) );
+
+      auto head = _head.load( std::memory_order_relaxed );
+      auto offset = head & ( capacity - 1 );
+      auto pad = capacity - offset < size ? capacity - offset : 0;
+
+      if( head + pad + size - _tail_cache > capacity ) {
+
+        _tail_cache = _tail.load( std::memory_order_acquire );
+
+        if( head + pad + size - _tail_cache > capacity ) {
+
+          _dropped.store( _dropped.load( std::memory_order_relaxed ) + 1, std::memory_order_relaxed );
+
+          return false;
+        }
+      }
+
+      //records don't wrap around
+      if( pad ) {
+
+        header h{ 0, std::uint32_t( pad - sizeof( header ) ) };
+
+        std::memcpy( _data.get() + offset, &h, sizeof( h ) );
+
+        head += pad;
+        offset = 0;
+      }
+
+      header h{ id, sizeof( T ) };
+
+      std::memcpy( _data.get() + offset, &h, sizeof( h ) );
+      std::memcpy( _data.get() + offset + sizeof( h ), &v, sizeof( T ) );
+
+      _head.store( head + size, std::memory_order_release );
+
+      return true;
+    }
+
+
+    //consumer, f( id, data ) for every record
+    template<typename F>
+    std::size_t pop_all ( F && f ) {
+
+      std::size_t n = 0;
+
+      auto tail = _tail.load( std::memory_order_relaxed );
+      auto head = _head.load( std::memory_order_acquire );
+
+      while( tail != head ) {
+
+        char const * p = _data.get() + ( tail & ( capacity - 1 ) );
+
+        header h;
+
+        std::memcpy( &h, p, sizeof( h ) );
+
+        if( h.id ) f( h.id, p + sizeof( h ) ), ++n;
+
+        tail += record_size( h.size );
+      }
+
+      _tail.store( tail, std::memory_order_release );
+
+      return n;
+    }
+
+    //producer and consumer positions are a cache line apart (padding, not alignas: rings are heap allocated)
+    std::atomic< std::uint64_t > _head{ 0 };
+    std::uint64_t _tail_cache = 0;
+    std::atomic< std::uint64_t > _dropped{ 0 };
+
+    char _pad[ LUPLE_CACHE_LINE ];
+
+    std::atomic< std::uint64_t > _tail{ 0 };
+    std::atomic< bool > _closed{ false };
+
+    std::unique_ptr< char[] > _data;
+  };
+
+
+  //Tag - to have several independent loggers
+
+  template<typename Tag = void>
+  struct logger {
+
+    //log( nuple ), log( luple )
+    template<typename T, typename = std::enable_if_t< ! intern::is_string<T>::value >>
+    static bool log ( T const & v ) {
+
+      static_assert( std::is_trivially_copyable<T>::value, "log records should be trivially copyable" );
+
+      return local().push( type_id< log_record<T> >(), v );
+    }
+
+    //log( $name("value {} of {}"), a, b )
+    template<typename F, typename... TT, typename = std::enable_if_t< intern::is_string<F>::value >>
+    static bool log ( F, TT const &... args ) {
+
+      using L = luple< TT... >;
+
+      static_assert( log_placeholders( F::value ) == sizeof...(TT), "the number of {} and arguments don't match" );
+      static_assert( std::is_trivially_copyable<L>::value, "log arguments should be trivially copyable" );
+
+      return local().push( type_id< log_message< F, L > >(), L{ args... } );
+    }
+
+
+    //format pending records of all threads, one line per record, returns the number of records
+    static std::size_t drain ( std::string & out ) {
+
+      auto & r = reg();
+      std::lock_guard< std::mutex > lock{ r.m };
+
+      std::size_t n = 0;
+
+      for( auto it = r.rings.begin(); it != r.rings.end(); ) {
+
+        auto & ring = **it;
+
+        //a closed ring gets no new records
+        bool closed = ring._closed.load( std::memory_order_acquire );
+
+        n += ring.pop_all( [&]( std::uint32_t id, char const * data ) {
+
+          r.types[ id - 1 ]( data, out );
+
+          out += '\n';
+        } );
+
+        if( closed ) {
+
+          r.dropped += ring._dropped.load( std::memory_order_relaxed );
+
+          it = r.rings.erase( it );
+
+        } else ++it;
+      }
+
+      return n;
+    }
+
+    //records that didn't fit into a ring
+    static std::uint64_t dropped () {
+
+      auto & r = reg();
+      std::lock_guard< std::mutex > lock{ r.m };
+
+      auto n = r.dropped;
+
+      for( auto & ring : r.rings ) n += ring->_dropped.load( std::memory_order_relaxed );
+
+      return n;
+    }
+
+
+    //drains into a FILE* on a background thread
+    struct writer {
+
+      writer ( std::FILE * f = stdout, std::chrono::milliseconds period = std::chrono::milliseconds{ 10 } ) :
+        _thread{ [this, f, period] {
+
+          std::string text;
+
+          for( bool stop = false; ! stop; ) {
+
+            stop = _stop.load( std::memory_order_acquire );
+
+            text.clear();
+
+            if( drain( text ) ) std::fwrite( text.data(), 1, text.size(), f ), std::fflush( f );
+
+            if( ! stop ) std::this_thread::sleep_for( period );
+          }
+        } } {}
+
+      ~writer () {
+
+        _stop.store( true, std::memory_order_release );
+
+        _thread.join();
+      }
+
+      writer ( writer const & ) = delete;
+      writer & operator= ( writer const & ) = delete;
+
+    private:
+
+      std::atomic< bool > _stop{ false };
+      std::thread _thread;
+    };
+
+
+    //ring of the calling thread
+
+    static log_ring & local () {
+
+      thread_local holder h;
+
+      return *h.ring;
+    }
+
+  private:
+
+    using format_t = void (*)( char const *, std::string & );
+
+    struct registry {
+
+      std::mutex m;
+      std::vector< format_t > types;
+      std::vector< std::unique_ptr< log_ring > > rings;
+      std::uint64_t dropped = 0;
+    };
+
+    static registry & reg () {
+
+      static registry r;
+
+      return r;
+    }
+
+    //the id of a record type, registered on first use
+    template<typename D>
+    static std::uint32_t type_id () {
+
+      static const std::uint32_t id = add_type( &D::format );
+
+      return id;
+    }
+
+    static std::uint32_t add_type ( format_t f ) {
+
+      auto & r = reg();
+      std::lock_guard< std::mutex > lock{ r.m };
+
+      r.types.push_back( f );
+
+      return std::uint32_t( r.types.size() );
+    }
+
+    //the ring is owned by the registry and freed after the last drain
+    struct holder {
+
+      holder () {
+
+        auto & r = reg();
+        std::lock_guard< std::mutex > lock{ r.m };
+
+        r.rings.emplace_back( new log_ring );
+
+        ring = r.rings.back().get();
+      }
+
+      ~holder () { ring->_closed.store( true, std::memory_order_release ); }
+
+      log_ring * ring;
+    };
+  };
+
+}
+
+
+//import into global namespace
+
+using nuple_ns::logger;
+
+using nuple_log = nuple_ns::logger<>;
+
+#endif // NUPLE_LOG_H
@@ -0,0 +1,256 @@
+/*
+
+nuple-metrics: per-thread counters defined as a nuple, exported by name (C++14)
+
+License: Public-domain software
+
+Description:
+
+  metrics< nuple< $("requests"), uint64_t, $("errors"), uint64_t, ... > > keeps one set of
+  counters per thread. A thread only ever writes its own counters, so an increment is a
+  relaxed load and a relaxed store of a std::atomic: a plain add to memory, no lock prefix,
+  no shared cache lines (every thread's counters are aligned to LUPLE_CACHE_LINE).
+
+  scrape() sums the counters of all live threads plus the totals of threads that exited,
+  write_prometheus() formats them in the Prometheus text format with the nuple names as
+  metric names. The "# TYPE name counter\nname " part of every line is built at compile
+  time from the interned name, at run time only the numbers are formatted.
+
+  Metric names are checked at compile time against [a-zA-Z_:][a-zA-Z0-9_:]*.
+  The Tag parameter allows several registries with the same nuple type.
+
+Dependencies:
+
+  nuple.h: nuple, name_t
+  luple.h: luple, luple_do, LUPLE_CACHE_LINE
+  atomic, mutex, vector, string, algorithm
+
+Usage:
+
+  #include "nuple-metrics.h"
+
+  using service_metrics = metrics< nuple< $("requests"), uint64_t, $("errors"), uint64_t > >;
+
+  //hot path
+  service_metrics::add< $("requests") >();
+  service_metrics::add< $("errors") >( 2 );
+
+  //or keep the thread's counters at hand
+  auto & m = service_metrics::local();
+  m.add< $("requests") >();
+
+  //scrape
+  auto totals = service_metrics::scrape(); //nuple< $("requests"), uint64_t, ... >
+
+  std::string text;
+  service_metrics::write_prometheus( text );
+
+  // # TYPE requests counter
+  // requests 42
+  // # TYPE errors counter
+  // errors 2
+
+*/
+
+#ifndef NUPLE_METRICS_H
+#define NUPLE_METRICS_H
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <string>
+#include <algorithm>
+
+#include "nuple.h"
+
+
+namespace nuple_ns {
+
+
+  //prometheus metric name check
+
+  constexpr bool metric_name_first ( char c ) { return ( c >= 'a' && c <= 'z' ) || ( c >= 'A' && c <= 'Z' ) || c == '_' || c == ':'; }
+
+  constexpr bool metric_name_valid ( char const * s ) {
+
+    if( ! metric_name_first( *s ) ) return false;
+
+    for( ++s; *s; ++s ) if( ! metric_name_first( *s ) && !( *s >= '0' && *s <= '9' ) ) return false;
+
+    return true;
+  }
+
+
+  //"# TYPE name counter\nname " for an interned name, NN... - indices of the name characters
+
+  template<typename S, typename I> struct metric_header;
+
+  template<typename S, int... NN> struct metric_header< S, std::integer_sequence<int, NN...> > {
+
+    static_assert( metric_name_valid( S::value ), "not a valid prometheus metric name" );
+
+    static constexpr char value[] = {
+      '#', ' ', 'T', 'Y', 'P', 'E', ' ', S::value[ NN ]..., ' ', 'c', 'o', 'u', 'n', 't', 'e', 'r', '\n', S::value[ NN ]..., ' ', '\0'
+    };
+
+    static const int size = sizeof( value ) - 1;
+  };
+
+  template<typename S, int... NN>
+  constexpr char metric_header< S, std::integer_sequence<int, NN...> >::value[];
+
+  template<typename S>
+  using metric_header_t = metric_header< S, std::make_integer_sequence< int, sizeof( S::value ) - 1 > >;
+
+
+  //N - nuple of counters, Tag - to have several registries of the same type
+
+  template<typename N, typename Tag = void>
+  struct metrics {
+
+    template<typename T> struct as_atomic;
+
+    template<typename... TT> struct as_atomic< luple_ns::type_list<TT...> > {
+
+      using type = luple< std::atomic<TT>... >;
+    };
+
+    using counters_t = typename as_atomic< typename N::type_list >::type;
+
+    template<typename S>
+    using index = luple_ns::tlist_get_n< typename N::name_list, S >;
+
+
+    //counters of one thread
+
+    struct alignas( LUPLE_CACHE_LINE ) thread_counters {
+
+      thread_counters () {
+
+        luple_do( _counters, []( auto & c ) { c.store( 0, std::memory_order_relaxed ); } );
+
+        auto & r = reg();
+        std::lock_guard< std::mutex > lock{ r.m };
+
+        r.threads.push_back( this );
+      }
+
+      //counters of an exiting thread go to the totals
+      ~thread_counters () {
+
+        auto & r = reg();
+        std::lock_guard< std::mutex > lock{ r.m };
+
+        sum_( r.retired, *this, seq{} );
+
+        r.threads.erase( std::find( r.threads.begin(), r.threads.end(), this ) );
+      }
+
+      thread_counters ( thread_counters const & ) = delete;
+      thread_counters & operator= ( thread_counters const & ) = delete;
+
+      template<typename S>
+      void add ( luple_ns::tlist_get_t< typename N::type_list, index<S>::value > n = 1 ) {
+
+        static_assert( index<S>::value != -1, "no such metric" );
+
+        auto & c = get< index<S>::value >( _counters );
+
+        c.store( c.load( std::memory_order_relaxed ) + n, std::memory_order_relaxed );
+      }
+
+      counters_t _counters;
+    };
+
+
+    //counters of the calling thread
+
+    static thread_counters & local () {
+
+      thread_local thread_counters counters;
+
+      return counters;
+    }
+
+    template<typename S>
+    static void add ( luple_ns::tlist_get_t< typename N::type_list, index<S>::value > n = 1 ) {
+
+      local().template add<S>( n );
+    }
+
+
+    //sum over all threads
+
+    static N scrape () {
+
+      N totals;
+
+      auto & r = reg();
+      std::lock_guard< std::mutex > lock{ r.m };
+
+      totals = r.retired;
+
+      for( auto t : r.threads ) sum_( totals, *t, seq{} );
+
+      return totals;
+    }
+
+
+    //prometheus text format
+
+    static void write_prometheus ( std::string & out ) {
+
+      write_( out, scrape(), seq{} );
+    }
+
+  private:
+
+    using seq = std::make_integer_sequence< int, N::size >;
+
+    template<int... NN>
+    static void sum_ ( N & totals, thread_counters const & t, std::integer_sequence<int, NN...> ) {
+
+      char dummy[] = { ( get<NN>( totals ) += get<NN>( t._counters ).load( std::memory_order_relaxed ), char{} )... };
+      (void) dummy;
+    }
+
+    template<int... NN>
+    static void write_ ( std::string & out, N const & totals, std::integer_sequence<int, NN...> ) {
+
+      char dummy[] = { ( write_one_< metric_header_t< name_t< N, NN > > >( out, get<NN>( totals ) ), char{} )... };
+      (void) dummy;
+    }
+
+    template<typename H, typename T>
+    static void write_one_ ( std::string & out, T const & value ) {
+
+      out.append( H::value, H::size );
+      out += std::to_string( value );
+      out += '\n';
+    }
+
+    struct registry {
+
+      registry () { luple_do( retired, []( auto & v ) { v = {}; } ); }
+
+      std::mutex m;
+      std::vector< thread_counters * > threads;
+      N retired;
+    };
+
+    static registry & reg () {
+
+      static registry r;
+
+      return r;
+    }
+  };
+
+}
+
+
+//import into global namespace
+
+using nuple_ns::metrics;
+
+#endif // NUPLE_METRICS_H
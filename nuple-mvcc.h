@@ -0,0 +1,361 @@
+/*
+
+nuple-mvcc: a table of nuples with snapshot isolation, copy-on-write rows (C++14)
+
+License: Public-domain software
+
+Description:
+
+  versioned_table< N > (N is a nuple or a luple) keeps for every row a list of versions,
+  newest first. An update copies only that row into a new version, readers take a snapshot
+  (the last committed version number) and see every row as it was at that moment, without
+  locks and without blocking the writer.
+
+  Changes are invisible until commit(), which publishes all of them at once with a single
+  store of the version counter. Several updates of one row before a commit change the same
+  uncommitted version.
+
+  Reclamation is epoch based: a snapshot pins its version in one of Readers slots (a CAS on
+  a slot owned by nobody else, no shared counter), a replaced row version is freed on a later
+  commit once no pinned snapshot is older than its replacement.
+
+  One writer at a time (protect insert/update/erase/commit with a mutex if needed). Readers
+  can run on any thread, a snapshot should not outlive the table. At most Readers snapshots
+  can be held at the same time: snapshot() throws std::length_error when it finds no free
+  slot in two passes over the slots.
+
+Dependencies:
+
+  nuple.h: nuple, get< $(...) >
+  atomic, vector, thread, cstdint, limits, stdexcept
+
+Usage:
+
+  #include "nuple-mvcc.h"
+
+  using account_t = nuple< $("id"), int, $("balance"), double >;
+
+  versioned_table< account_t > accounts;
+
+  //writer
+  auto a = accounts.insert( account_t{ 1, 100. } );
+  auto b = accounts.insert( account_t{ 2, 50. } );
+  accounts.commit();
+
+  accounts.update( a, []( account_t & r ) { get< $("balance") >( r ) -= 10; } );
+  accounts.update( b, []( account_t & r ) { get< $("balance") >( r ) += 10; } );
+  accounts.commit(); //both or none are visible
+
+  //readers
+  auto s = accounts.snapshot();
+
+  account_t const * r = s.find( a ); //nullptr if not visible
+  double total = 0;
+  s.each( [&]( std::size_t row, account_t const & r ) { total += get< $("balance") >( r ); } );
+
+  //bench/mvcc-bench.cpp measures read throughput under concurrent writes
+
+*/
+
+#ifndef NUPLE_MVCC_H
+#define NUPLE_MVCC_H
+
+#include <atomic>
+#include <vector>
+#include <thread>
+#include <cstdint>
+#include <cstddef>
+#include <limits>
+#include <functional>
+#include <stdexcept>
+
+#include "nuple.h"
+
+
+namespace nuple_ns {
+
+
+  //N - row type, Readers - number of snapshots that can be held at the same time
+
+  template<typename N, int Readers = 64>
+  struct versioned_table {
+
+    using value_type = N;
+
+    //one version of a row
+    struct node {
+
+      N value;
+      std::uint64_t version; //visible to snapshots >= version
+      bool erased;
+      std::atomic< node * > older;
+    };
+
+    static const int chunk_bits = 12;
+    static const std::size_t chunk_size = std::size_t{ 1 } << chunk_bits;
+    static const std::size_t max_chunks = 4096;
+
+    static const std::uint64_t idle = std::numeric_limits< std::uint64_t >::max();
+
+    versioned_table () {
+
+      for( auto & c : _chunks ) c.store( nullptr, std::memory_order_relaxed );
+      for( auto & s : _slots ) s.pin.store( idle, std::memory_order_relaxed );
+    }
+
+    ~versioned_table () {
+
+      for( std::size_t i = 0; i < _size.load( std::memory_order_relaxed ); ++i ) free_( head_( i ).load( std::memory_order_relaxed ) );
+
+      for( auto & c : _chunks ) delete[] c.load( std::memory_order_relaxed );
+    }
+
+    versioned_table ( versioned_table const & ) = delete;
+    versioned_table & operator= ( versioned_table const & ) = delete;
+
+
+    //a consistent view of the table at the last commit
+
+    struct snapshot_t {
+
+      snapshot_t ( versioned_table const & t, int slot, std::uint64_t version ) : _t{ &t }, _slot{ slot }, _version{ version } {}
+
+      snapshot_t ( snapshot_t && s ) : _t{ s._t }, _slot{ s._slot }, _version{ s._version } { s._t = nullptr; }
+
+      snapshot_t ( snapshot_t const & ) = delete;
+      snapshot_t & operator= ( snapshot_t const & ) = delete;
+
+      ~snapshot_t () { if( _t ) _t->_slots[ _slot ].pin.store( idle, std::memory_order_release ); }
+
+      //the row as of the snapshot or nullptr (not inserted yet or erased)
+      N const * find ( std::size_t row ) const {
+
+        if( row >= _t->_size.load( std::memory_order_acquire ) ) return nullptr;
+
+        node * n = _t->head_( row ).load( std::memory_order_acquire );
+
+        while( n && n->version > _version ) n = n->older.load( std::memory_order_acquire );
+
+        return n && ! n->erased ? &n->value : nullptr;
+      }
+
+      //f( row, value ) for every visible row
+      template<typename F>
+      void each ( F && f ) const {
+
+        for( std::size_t i = 0, size = _t->_size.load( std::memory_order_acquire ); i < size; ++i )
+
+          if( auto r = find( i ) ) f( i, *r );
+      }
+
+      std::uint64_t version () const { return _version; }
+
+      //upper bound of row indices
+      std::size_t size () const { return _t->_size.load( std::memory_order_acquire ); }
+
+    private:
+
+      versioned_table const * _t;
+      int _slot;
+      std::uint64_t _version;
+    };
+
+    snapshot_t snapshot () const {
+
+      int slot = acquire_slot_();
+
+      auto & pin = _slots[ slot ].pin;
+
+      //the pin has to be visible before a writer frees versions older than it
+      auto version = _committed.load( std::memory_order_seq_cst );
+
+      for( ;; ) {
+
+        pin.store( version, std::memory_order_seq_cst );
+
+        auto again = _committed.load( std::memory_order_seq_cst );
+
+        if( again == version ) break;
+
+        version = again;
+      }
+
+      return snapshot_t{ *this, slot, version };
+    }
+
+
+    //writer
+
+    std::size_t insert ( N const & value ) {
+
+      std::size_t row = _size.load( std::memory_order_relaxed );
+
+      if( ( row >> chunk_bits ) >= max_chunks ) throw std::length_error( "versioned_table is full" );
+
+      auto & chunk = _chunks[ row >> chunk_bits ];
+
+      if( ! chunk.load( std::memory_order_relaxed ) ) {
+
+        auto c = new std::atomic< node * >[ chunk_size ];
+
+        for( std::size_t i = 0; i < chunk_size; ++i ) c[ i ].store( nullptr, std::memory_order_relaxed );
+
+        chunk.store( c, std::memory_order_release );
+      }
+
+      head_( row ).store( new node{ value, _pending(), false, { nullptr } }, std::memory_order_release );
+
+      _size.store( row + 1, std::memory_order_release );
+
+      return row;
+    }
+
+    //f( N & ) changes a copy of the row, an erased row is brought back
+    template<typename F>
+    void update ( std::size_t row, F && f ) {
+
+      f( write_( row, false )->value );
+    }
+
+    void update ( std::size_t row, N const & value ) {
+
+      write_( row, false )->value = value;
+    }
+
+    void erase ( std::size_t row ) { write_( row, true ); }
+
+    //makes the changes visible, frees versions that no snapshot can reach
+    void commit () {
+
+      _committed.store( _pending(), std::memory_order_seq_cst );
+
+      collect_();
+    }
+
+    //the newest version of a row, including uncommitted changes
+    N const * latest ( std::size_t row ) const {
+
+      node * n = row < _size.load( std::memory_order_relaxed ) ? head_( row ).load( std::memory_order_relaxed ) : nullptr;
+
+      return n && ! n->erased ? &n->value : nullptr;
+    }
+
+    std::size_t size () const { return _size.load( std::memory_order_acquire ); }
+
+    std::uint64_t version () const { return _committed.load( std::memory_order_acquire ); }
+
+    //versions waiting to be freed
+    std::size_t retired () const { return _retired.size(); }
+
+  private:
+
+    std::uint64_t _pending () const { return _committed.load( std::memory_order_relaxed ) + 1; }
+
+    std::atomic< node * > & head_ ( std::size_t row ) const {
+
+      return _chunks[ row >> chunk_bits ].load( std::memory_order_acquire )[ row & ( chunk_size - 1 ) ];
+    }
+
+    //the uncommitted version of a row, created on the first change after a commit
+    node * write_ ( std::size_t row, bool erased ) {
+
+      auto & head = head_( row );
+
+      node * h = head.load( std::memory_order_relaxed );
+
+      if( h->version == _pending() ) { h->erased = erased; return h; }
+
+      node * n = new node{ h->value, _pending(), erased, { h } };
+
+      head.store( n, std::memory_order_release );
+
+      _retired.push_back( n );
+
+      return n;
+    }
+
+    //free the versions behind retired nodes when no snapshot older than them is pinned
+    void collect_ () {
+
+      auto oldest = _committed.load( std::memory_order_seq_cst );
+
+      for( auto & s : _slots ) {
+
+        auto pin = s.pin.load( std::memory_order_seq_cst );
+
+        if( pin < oldest ) oldest = pin;
+      }
+
+      //retired versions are in commit order
+      std::size_t n = 0;
+
+      for( ; n < _retired.size() && _retired[ n ]->version <= oldest; ++n ) {
+
+        node * older = _retired[ n ]->older.exchange( nullptr, std::memory_order_relaxed );
+
+        free_( older );
+      }
+
+      _retired.erase( _retired.begin(), _retired.begin() + n );
+    }
+
+    static void free_ ( node * n ) {
+
+      while( n ) {
+
+        node * older = n->older.load( std::memory_order_relaxed );
+
+        delete n;
+
+        n = older;
+      }
+    }
+
+    int acquire_slot_ () const {
+
+      int start = int( std::hash< std::thread::id >{}( std::this_thread::get_id() ) % Readers );
+
+      //the second pass catches slots released during the first one
+      for( int pass = 0; pass < 2; ++pass ) {
+
+        for( int i = 0; i < Readers; ++i ) {
+
+          auto & pin = _slots[ ( start + i ) % Readers ].pin;
+
+          auto expected = idle;
+
+          //claimed with a placeholder that doesn't hold back reclamation until the real pin is stored
+          if( pin.load( std::memory_order_relaxed ) == idle && pin.compare_exchange_strong( expected, idle - 1, std::memory_order_acquire ) )
+
+            return ( start + i ) % Readers;
+        }
+
+        std::this_thread::yield();
+      }
+
+      throw std::length_error( "versioned_table: more than Readers snapshots are held" );
+    }
+
+    struct alignas( LUPLE_CACHE_LINE ) slot {
+
+      std::atomic< std::uint64_t > pin;
+    };
+
+    mutable slot _slots[ Readers ];
+
+    std::atomic< std::uint64_t > _committed{ 0 };
+    std::atomic< std::size_t > _size{ 0 };
+
+    mutable std::atomic< std::atomic< node * > * > _chunks[ max_chunks ];
+
+    std::vector< node * > _retired;
+  };
+
+}
+
+
+//import into global namespace
+
+using nuple_ns::versioned_table;
+
+#endif // NUPLE_MVCC_H
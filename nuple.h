@@ -64,12 +64,23 @@ Usage:
   //see luple.h for more examples
 
 
+  //allocators: members that take an allocator get it (see luple.h)
+
+  using record_t = nuple< $("name"), std::pmr::string, $("id"), int >;
+
+  record_t r{ std::allocator_arg, &resource, "john", 5 };
+
+  auto r2 = as_nuple( std::allocator_arg, &resource, $name("name"), std::pmr::string{ "john" }, $name("id"), 6 );
+
+
   // nuple_ns::nuple_t - return type for tag name by index
 
   using field0_t = nuple_ns::name_t< nameid_t, 0 >; //the same as $("name")
 
 */
 
+#ifndef NUPLE_NUPLE_H
+#define NUPLE_NUPLE_H
 
 #include "luple.h"
 #include "intern.h"
@@ -166,33 +177,73 @@ namespace nuple_ns {
   };
 
 
-  template<typename... TT, int... NN> 
-  auto as_nuple_( luple<TT...> l, std::integer_sequence< int, NN... > ) {
+  //refs - luple of references to all arguments, values (odd arguments) are forwarded into the nuple
+
+  template<typename... TT, typename R, int... NN> 
+  constexpr auto as_nuple_( luple_ns::type_list<TT...>, R & refs, std::integer_sequence< int, NN... > ) {
 
-    using param_list = luple_ns::type_list<TT...>;
+    using param_list = luple_ns::type_list< std::decay_t<TT>... >;
 
     static_assert( check_args<param_list>::value, "order of arguments should be name, value..." );
 
-    return nuple< TT... >{ std::move( get<NN*2+1>( l ) )... };
+    return nuple< std::decay_t<TT>... >{ 
+      static_cast< luple_ns::tlist_get_t< luple_ns::type_list<TT...>, NN*2+1 > && >( get<NN*2+1>( refs ) )... 
+    };
   }
   
   //as_nuple( $name("..."), value, ... ) -> nuple< $(...), decltype( value ), ... >
   //note the difference between $name(..) and $(...)
+  //values are forwarded into the members: one copy for an lvalue, one move for an rvalue
 
   template<typename... TT>
-  auto as_nuple( TT... args ) {
+  constexpr auto as_nuple( TT &&... args ) {
 
     static_assert( sizeof...(TT) % 2 == 0, "wrong number of arguments");
 
-    return as_nuple_( luple< TT... >{ std::move( args )... }, std::make_integer_sequence< int, sizeof...(TT)/2 >{} );
+    luple< TT &&... > refs{ std::forward<TT>( args )... };
+
+    return as_nuple_( luple_ns::type_list<TT...>{}, refs, std::make_integer_sequence< int, sizeof...(TT)/2 >{} );
+  }
+
+
+  //as_nuple( std::allocator_arg, a, $name("..."), value, ... ), members that take an allocator get a
+
+  template<typename... TT, typename R, typename A, int... NN> 
+  constexpr auto as_nuple_( luple_ns::type_list<TT...>, R & refs, std::integer_sequence< int, NN... >, A const & a ) {
+
+    using param_list = luple_ns::type_list< std::decay_t<TT>... >;
+
+    static_assert( check_args<param_list>::value, "order of arguments should be name, value..." );
+
+    return nuple< std::decay_t<TT>... >{ std::allocator_arg, a,
+      static_cast< luple_ns::tlist_get_t< luple_ns::type_list<TT...>, NN*2+1 > && >( get<NN*2+1>( refs ) )... 
+    };
+  }
+
+  template<typename A, typename... TT>
+  constexpr auto as_nuple( std::allocator_arg_t, A && a, TT &&... args ) {
+
+    static_assert( sizeof...(TT) % 2 == 0, "wrong number of arguments");
+
+    luple< TT &&... > refs{ std::forward<TT>( args )... };
+
+    return as_nuple_( luple_ns::type_list<TT...>{}, refs, std::make_integer_sequence< int, sizeof...(TT)/2 >{}, a );
   }
 
 }
 
+
+//allocator-aware containers pass their allocator to a nuple that has an allocator-aware member
+
+namespace std {
+
+  template<typename... TT, typename A> struct uses_allocator< nuple_ns::nuple<TT...>, A > : uses_allocator< typename nuple_ns::nuple<TT...>::base, A > {};
+}
+
 //import into global namespace
 
 using nuple_ns::nuple;
 using nuple_ns::get;
 using nuple_ns::as_nuple;
 
-
+#endif // NUPLE_NUPLE_H
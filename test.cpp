@@ -4,10 +4,32 @@
  */
 
 #include "luple.h"
+#include "nuple.h"
 #include "struct-reader.h"
 #include "type-loophole.h"
+#include "luple-math.h"
+#include "luple-bits.h"
+#include "luple-archetype.h"
+#include "luple-table.h"
+#include "nuple-join.h"
+#include "luple-column.h"
+#include "luple-arena.h"
+#include "luple-seqlock.h"
+#include "luple-queue.h"
+#include "nuple-index.h"
+#include "nuple-csv.h"
+#include "nuple-mvcc.h"
+#include "nuple-group.h"
+#include "nuple-metrics.h"
+#include "nuple-log.h"
 
 #include <vector>
+#include <algorithm>
+#include <scoped_allocator>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <atomic>
 
 struct EmptyStruct {};
 
@@ -41,7 +63,743 @@ namespace loophole_ns
     static_assert(std::is_same<as_type_list<StructureWithVector>, luple_ns::type_list<int, std::vector<int>>>::value);
 }
 
+namespace luple_ns
+{
+    static_assert(std::is_same<tlist_cat_t<type_list<int>, type_list<>, type_list<char, short>>, type_list<int, char, short>>::value);
+
+    constexpr luple<int> l0{1};
+    constexpr luple<char, short> l1{'a', short(2)};
+    constexpr auto l2 = luple_cat(l0, luple<>{}, l1);
+
+    static_assert(std::is_same<std::decay_t<decltype(l2)>, luple<int, char, short>>::value);
+    static_assert(get<0>(l2) == 1 && get<1>(l2) == 'a' && get<2>(l2) == 2);
+    static_assert(std::is_same<decltype(luple_cat_view(l0, l1)), luple<int const&, char const&, short const&>>::value);
+}
+
+namespace luple_ns
+{
+    static_assert(sizeof(padded_luple<char, char>) == 2 * LUPLE_CACHE_LINE);
+    static_assert(alignof(padded_luple<char, char>) == LUPLE_CACHE_LINE);
+    static_assert(std::is_same<element_t<padded_luple<char, int>, 1>, int>::value);
+
+    constexpr padded_luple<int, char> padded{1, 'a'};
+    static_assert(get<char>(padded) == 'a' && get<0>(padded) == 1);
+    static_assert(std::is_same<tlist_cat_t<padded_list<int, char>, type_list<short>>, type_list<int, char, short>>::value);
+
+    bool testPaddedCat()
+    {
+        padded_luple<int, char> p{1, 'b'};
+        luple<short> l{short(3)};
+
+        auto joined = luple_cat(p, l, padded_luple<long>{4});
+        auto view = luple_cat_view(l, p);
+        get<2>(view) = 'c';
+
+        static_assert(std::is_same<decltype(joined), luple<int, char, short, long>>::value);
+
+        return get<0>(joined) == 1 && get<1>(joined) == 'b' && get<2>(joined) == 3 && get<3>(joined) == 4
+            && get<1>(view) == 1 && get<1>(p) == 'c';
+    }
+}
+
+namespace luple_ns
+{
+    static_assert(is_vec<luple<float, float, float, float>>::value);
+    static_assert(is_vec<luple<int>>::value);
+    static_assert(!is_vec<luple<float, double>>::value);
+    static_assert(!is_vec<luple<float*, float*>>::value);
+    static_assert(!is_vec<luple<>>::value);
+
+    // Every operation against a scalar loop; the values are exact in float, so the SSE, AVX
+    // and scalar (LUPLE_NO_SIMD) paths must agree bit for bit
+    template<typename V>
+    bool testMathOf()
+    {
+        using T = element_t<V, 0>;
+        const int size = V::size;
+
+        bool ok = true;
+
+        for (std::size_t n : {0, 1, 2, 3, 5, 13}) {
+            std::vector<V> a(n + 1), b(n + 1), c(n + 1), out(n + 1);
+            std::vector<T> dots(n + 1);
+
+            for (std::size_t i = 0; i < n; ++i)
+                for (int k = 0; k < size; ++k) {
+                    (&get<0>(a[i]))[k] = T(int((i * size + k) % 17) - 8) / 2;
+                    (&get<0>(b[i]))[k] = T(int((i * size + k) % 5) + 1);
+                    (&get<0>(c[i]))[k] = T(int((i * size + k) % 3));
+                }
+
+            auto check = [&](auto batch, auto single, auto scalar) {
+                for (auto& o : out) luple_do(o, [](auto& v) { v = -99; });
+                batch();
+                for (std::size_t i = 0; i < n; ++i) {
+                    V r = single(a[i], b[i], c[i]);
+                    for (int k = 0; k < size; ++k) {
+                        T x = (&get<0>(a[i]))[k], y = (&get<0>(b[i]))[k], z = (&get<0>(c[i]))[k];
+                        ok = ok && (&get<0>(out[i]))[k] == scalar(x, y, z) && (&get<0>(r))[k] == scalar(x, y, z);
+                    }
+                }
+                //nothing written past n
+                ok = ok && get<0>(out[n]) == -99;
+            };
+
+            check([&] { luple_add_n(a.data(), b.data(), out.data(), n); }, [](V x, V y, V) { return x + y; }, [](T x, T y, T) { return x + y; });
+            check([&] { luple_sub_n(a.data(), b.data(), out.data(), n); }, [](V x, V y, V) { V r = x; r -= y; return r; }, [](T x, T y, T) { return x - y; });
+            check([&] { luple_mul_n(a.data(), b.data(), out.data(), n); }, [](V x, V y, V) { return x * y; }, [](T x, T y, T) { return x * y; });
+            check([&] { luple_div_n(a.data(), b.data(), out.data(), n); }, [](V x, V y, V) { return x / y; }, [](T x, T y, T) { return x / y; });
+            check([&] { luple_min_n(a.data(), b.data(), out.data(), n); }, [](V x, V y, V) { return luple_min(x, y); }, [](T x, T y, T) { return x < y ? x : y; });
+            check([&] { luple_max_n(a.data(), b.data(), out.data(), n); }, [](V x, V y, V) { return luple_max(x, y); }, [](T x, T y, T) { return x > y ? x : y; });
+            check([&] { luple_fma_n(a.data(), b.data(), c.data(), out.data(), n); }, [](V x, V y, V z) { return luple_fma(x, y, z); }, [](T x, T y, T z) { return x * y + z; });
+
+            //operators with a scalar on either side
+            for (std::size_t i = 0; i < n; ++i) {
+                V r = T(2) * a[i] + T(1) - a[i] / T(2);
+                for (int k = 0; k < size; ++k) {
+                    T x = (&get<0>(a[i]))[k];
+                    ok = ok && (&get<0>(r))[k] == T(2) * x + T(1) - x / T(2);
+                }
+            }
+
+            luple_dot_n(a.data(), b.data(), dots.data(), n);
+            for (std::size_t i = 0; i < n; ++i) {
+                T dot = 0;
+                for (int k = 0; k < size; ++k) dot += (&get<0>(a[i]))[k] * (&get<0>(b[i]))[k];
+                ok = ok && dots[i] == dot && luple_dot(a[i], b[i]) == dot;
+            }
+        }
+
+        //n == 0 doesn't touch the pointers
+        luple_add_n<typename V::type_list>(nullptr, nullptr, nullptr, 0);
+        luple_fma_n<typename V::type_list>(nullptr, nullptr, nullptr, nullptr, 0);
+
+        return ok;
+    }
+
+    bool testMath()
+    {
+        return testMathOf<luple<float, float, float>>() && testMathOf<luple<float, float, float, float, float, float, float, float, float>>()
+            && testMathOf<luple<double, double>>() && testMathOf<luple<double, double, double, double, double>>()
+            && testMathOf<luple<int, int, int>>();
+    }
+}
+
+namespace luple_ns
+{
+    using packed_t = bit_luple<bits<3>, bits<1>, bits<12>, bits<5, int>>;
+
+    static_assert(sizeof(packed_t) == 4);
+    static_assert(sizeof(bit_luple<bits<60>, bits<10>, bits<3>>) == 16);
+
+    constexpr packed_t packed{5, true, 4095, -16};
+    static_assert(get<0>(packed) == 5 && get<1>(packed) && get<2>(packed) == 4095 && get<3>(packed) == -16);
+}
+
+namespace luple_ns
+{
+    // Counts copies and moves on the way into the storage
+    struct Counted
+    {
+        int copies = 0;
+        int moves = 0;
+
+        constexpr Counted() {}
+        constexpr Counted(const Counted& o) : copies(o.copies + 1), moves(o.moves) {}
+        constexpr Counted(Counted&& o) : copies(o.copies), moves(o.moves + 1) {}
+    };
+
+    constexpr bool counts(const Counted& c, int copies, int moves)
+    {
+        return c.copies == copies && c.moves == moves;
+    }
+
+    constexpr Counted counted{};
+    constexpr luple<Counted, int> counted_luple{counted, 1};
+
+    static_assert(counts(get<0>(counted_luple), 1, 0));
+    static_assert(counts(get<0>(luple<Counted, int>{Counted{}, 1}), 0, 1));
+
+    static_assert(counts(get<0>(as_luple(counted, 1)), 1, 0));
+    static_assert(counts(get<0>(as_luple(Counted{}, 1)), 0, 1));
+
+    static_assert(counts(get<0>(luple<Counted, int>{counted_luple}), 2, 0));
+    static_assert(counts(get<0>(luple<Counted, long>{counted_luple}), 2, 0));
+    static_assert(counts(get<0>(luple<Counted, long>{luple<Counted, int>{Counted{}, 1}}), 0, 2));
+
+    static_assert(counts(get<0>(luple_cat(counted_luple, luple<int>{2})), 2, 0));
+    static_assert(counts(get<0>(luple_cat(luple<Counted, int>{Counted{}, 1}, luple<int>{2})), 0, 2));
+}
+
+namespace nuple_ns
+{
+    static_assert(counts(get<$("key")>(as_nuple($name("key"), luple_ns::counted, $name("val"), 1)), 1, 0));
+    static_assert(counts(get<$("key")>(as_nuple($name("key"), luple_ns::Counted{}, $name("val"), 1)), 0, 1));
+}
+
+namespace luple_ns
+{
+    struct EmptyTag {};
+    struct FinalTag final {};
+
+    static_assert(sizeof(luple<EmptyTag, int>) == sizeof(int));
+    static_assert(sizeof(luple<int, EmptyStruct, EmptyTag>) == sizeof(int));
+    static_assert(sizeof(luple<FinalTag, int>) == 2 * sizeof(int));
+
+    constexpr luple<EmptyTag, int> tagged{EmptyTag{}, 1};
+    static_assert(std::is_same<decltype(get<0>(tagged)), const EmptyTag&>::value);
+    static_assert(get<int>(tagged) == 1);
+
+    // An empty member is stored as a base but its interface doesn't leak into the luple
+    struct EmptyCallable { constexpr int operator()(int, int) const { return 1; } };
+
+    constexpr luple<EmptyCallable, int> callable{EmptyCallable{}, 2};
+    static_assert(sizeof(callable) == sizeof(int) && get<0>(callable)(1, 2) == 1);
+    static_assert(!std::is_invocable<luple<EmptyCallable, int>, int, int>::value);
+    static_assert(!std::is_convertible<luple<EmptyCallable, int>&, EmptyCallable&>::value);
+    static_assert(!std::is_convertible<const luple<EmptyCallable, int>&, const EmptyCallable&>::value);
+}
+
+namespace luple_ns
+{
+    struct TagAlloc { using value_type = char; int id; };
+
+    struct LeadingAlloc
+    {
+        using allocator_type = TagAlloc;
+        int id = 0;
+        constexpr LeadingAlloc() {}
+        constexpr LeadingAlloc(std::allocator_arg_t, const TagAlloc& a) : id(a.id) {}
+        constexpr LeadingAlloc(std::allocator_arg_t, const TagAlloc& a, const LeadingAlloc&) : id(a.id) {}
+    };
+
+    struct TrailingAlloc
+    {
+        using allocator_type = TagAlloc;
+        int id = 0, value = 0;
+        constexpr TrailingAlloc(int v) : value(v) {}
+        constexpr TrailingAlloc(int v, const TagAlloc& a) : id(a.id), value(v) {}
+        constexpr TrailingAlloc(const TrailingAlloc& o, const TagAlloc& a) : id(a.id), value(o.value) {}
+    };
+
+    using AllocLuple = luple<LeadingAlloc, TrailingAlloc, int>;
+
+    static_assert(std::uses_allocator<AllocLuple, TagAlloc>::value);
+    static_assert(!std::uses_allocator<luple<int, char>, TagAlloc>::value);
+
+    constexpr AllocLuple allocated{std::allocator_arg, TagAlloc{7}, LeadingAlloc{}, 2, 3};
+    static_assert(get<0>(allocated).id == 7 && get<1>(allocated).id == 7 && get<1>(allocated).value == 2);
+    static_assert(get<1>(AllocLuple{std::allocator_arg, TagAlloc{8}, allocated}).id == 8);
+}
+
+namespace luple_ns
+{
+    using ArchetypeLayout = archetype_layout<type_list<float, double>>;
+
+    static_assert(ArchetypeLayout::capacity == LUPLE_CHUNK_SIZE / 16);
+    static_assert(ArchetypeLayout::offsets[1] % alignof(double) == 0);
+    static_assert(archetype_has<type_list<int, float, char>, char, int>());
+    static_assert(!archetype_has<type_list<int, float>, char>());
+}
+
+namespace luple_ns
+{
+    using Element = luple<int, char const*>;
+
+    constexpr Element elements[] = {{8, "O"}, {1, "H"}, {6, "C"}, {2, "He"}};
+
+    constexpr auto by_number = make_static_table<keys<0>>(elements);
+    constexpr auto by_symbol = make_static_table<keys<1>, table_eytzinger>(elements);
+    constexpr auto by_hash = make_static_table<keys<0>, table_hash>(elements);
+
+    static_assert(get<0>(by_number[0]) == 1 && get<0>(by_number[3]) == 8);
+    static_assert(get<1>(*by_number.find(6))[0] == 'C' && by_number.find(5) == nullptr);
+    static_assert(get<0>(*by_symbol.find("He")) == 2 && by_symbol.find("X") == nullptr);
+    static_assert(get<0>(*by_hash.find(8)) == 8 && by_hash.find(3) == nullptr);
+}
+
+namespace nuple_ns
+{
+    using Order = nuple<$("order_id"), int, $("px"), double>;
+    using Fill = nuple<$("fill_id"), int, $("order_id"), int, $("px"), double>;
+
+    static_assert(std::is_same<join_row_t<Order, Fill, luple_ns::type_list<$("order_id")>>,
+                               nuple<$("order_id"), int, $("px"), double, $("fill_id"), int, $("right_px"), double>>::value);
+}
+
+namespace luple_ns
+{
+    enum class Side : char { buy, sell };
+
+    static_assert(column_kind<Side>::value == 0 && column_kind<bool>::value == 0);
+    static_assert(column_kind<float>::value == 1 && column_kind<std::string>::value == 2);
+    static_assert(column_from_key<int>(column_to_key(-7)) == -7 && column_to_key(-1) < column_to_key(0));
+    static_assert(column_from_key<Side>(column_to_key(Side::sell)) == Side::sell);
+}
+
+namespace luple_ns
+{
+    struct alignas(128) OverAligned { char bytes[8]; };
+
+    template<typename T> using ArenaVector = std::vector<T, std::scoped_allocator_adaptor<arena_allocator<T>>>;
+    using ArenaString = std::basic_string<char, std::char_traits<char>, arena_allocator<char>>;
+
+    bool testArena()
+    {
+        arena a{256};
+
+        for (int i = 0; i < 50; ++i) {
+            void* p = a.allocate(8, 128);
+            void* q = a.allocate(64, 64);
+            if (reinterpret_cast<std::uintptr_t>(p) % 128 || reinterpret_cast<std::uintptr_t>(q) % 64)
+                return false;
+        }
+
+        padded_luple<char, int>* padded = new (a.allocate(sizeof(padded_luple<char, int>), alignof(padded_luple<char, int>))) padded_luple<char, int>{'a', 1};
+        OverAligned* over = arena_allocator<OverAligned>{&a}.allocate(3);
+
+        bool ok = reinterpret_cast<std::uintptr_t>(padded) % LUPLE_CACHE_LINE == 0 && get<1>(*padded) == 1
+               && reinterpret_cast<std::uintptr_t>(over) % 128 == 0;
+
+        a.release();
+
+        {
+            ArenaVector<luple<ArenaString, int>> records(&a);
+            records.emplace_back("a string long enough to leave the small buffer", 1);
+
+            std::size_t used = a.used();
+            ok = ok && get<0>(records[0]).get_allocator()._arena == &a && used >= sizeof(luple<ArenaString, int>) + 46;
+        }
+
+        std::pmr::vector<luple<std::pmr::string, std::pmr::vector<int>>> pmr(&a);
+        pmr.emplace_back("another string long enough to leave the small buffer", std::initializer_list<int>{1, 2});
+
+        return ok && get<0>(pmr[0]).get_allocator().resource() == &a && get<1>(pmr[0]).get_allocator().resource() == &a
+                  && get<1>(pmr[0])[1] == 2;
+    }
+}
+
+namespace nuple_ns
+{
+    using Account = nuple<$("id"), int, $("owner"), std::string, $("branch"), int>;
+
+    bool testIndex()
+    {
+        std::vector<Account> rows{{1, "ann", 10}, {2, "bob", 20}, {3, "ann", 20}};
+
+        auto byId = make_index<$("id")>(rows);
+        auto byOwner = make_index<$("owner")>(rows);
+        auto byOwnerBranch = make_index<$("owner"), $("branch")>(rows);
+
+        std::string_view bob{"bob"};
+        int anns = 0;
+        byOwner.find_all(luple_tie("ann"), [&](int) { ++anns; });
+
+        bool ok = byId.find(2) == 1 && byId.find(4) == -1 && anns == 2
+               && byOwner.find(bob) == 1 && byOwner.find("carl") == -1
+               && byOwnerBranch.find(std::string{"ann"}, 20) == 2 && byOwnerBranch.find("bob", 10) == -1;
+
+        //swap and pop row 0
+        byId.erase(0);
+        rows[0] = std::move(rows.back());
+        rows.pop_back();
+        byId.relocate(2, 0);
+
+        return ok && byId.find(1) == -1 && byId.find(3) == 0 && byId.find(2) == 1 && byId.size() == 2;
+    }
+}
+
+namespace nuple_ns
+{
+    using Quote = nuple<$("sym"), std::string_view, $("px"), double, $("qty"), int, $("live"), bool>;
+
+    bool testCsv()
+    {
+        char const text[] = "qty,sym,skipped,px,live\r\n"
+                            "10,IBM,x,101.25,true\r\n"
+                            "-3,\"A,B\",y,1e3,0\n"
+                            "\n"
+                            "7,MSFT\n";
+
+        auto rows = parse_csv<Quote>(text, text + sizeof(text) - 1);
+
+        return rows.size() == 3
+            && get<$("sym")>(rows[0]) == "IBM" && get<$("px")>(rows[0]) == 101.25 && get<$("qty")>(rows[0]) == 10 && get<$("live")>(rows[0])
+            && get<$("sym")>(rows[1]) == "A,B" && get<$("px")>(rows[1]) == 1000 && get<$("qty")>(rows[1]) == -3 && !get<$("live")>(rows[1])
+            && get<$("sym")>(rows[2]) == "MSFT" && get<$("qty")>(rows[2]) == 7 && get<$("px")>(rows[2]) == 0 && !get<$("live")>(rows[2]);
+    }
+}
+
+namespace luple_ns
+{
+    struct Pos { float x, y; };
+    struct Vel { float x, y; };
+
+    bool testArchetype()
+    {
+        entity_store<type_list<Pos, Vel>, type_list<Pos>> world;
+
+        auto a = world.create(Pos{0, 0}, Vel{1, 2});
+        auto b = world.create(Pos{5, 5});
+        auto c = world.create(Pos{1, 1}, Vel{3, 3});
+
+        world.each<Pos, Vel>([](Pos& p, const Vel& v) { p.x += v.x; p.y += v.y; });
+
+        world.destroy(a);
+        world.destroy(a);
+        auto d = world.create(Pos{7, 7});
+
+        return !world.alive(a) && world.find<Pos>(a) == nullptr && world.archetype(a) == -1
+            && world.get<Pos>(c).x == 4 && world.find<Vel>(b) == nullptr && world.get<Pos>(d).x == 7
+            && world.alive(b) && world.alive(c) && world.alive(d);
+    }
+}
+
+namespace nuple_ns
+{
+    using Balance = nuple<$("id"), int, $("balance"), double>;
+
+    bool testMvcc()
+    {
+        versioned_table<Balance, 2> table;
+
+        auto row = table.insert(Balance{1, 100.});
+        table.commit();
+
+        auto before = table.snapshot();
+
+        table.update(row, [](Balance& b) { get<$("balance")>(b) -= 10; });
+        bool hidden = get<$("balance")>(*table.snapshot().find(row)) == 100;
+        table.commit();
+
+        auto after = table.snapshot();
+
+        bool full = false;
+        try { table.snapshot(); } catch (std::length_error const&) { full = true; }
+
+        return hidden && full && get<$("balance")>(*before.find(row)) == 100 && get<$("balance")>(*after.find(row)) == 90;
+    }
+}
+
+namespace luple_ns
+{
+    using Quotes = type_list<double, double, long>;
+
+    static_assert(alignof(seqlock_luple<Quotes>) == LUPLE_CACHE_LINE);
+
+    bool testSeqlock()
+    {
+        seqlock_luple<Quotes> quotes{luple_t<Quotes>{1., 2., 3}};
+
+        bool ok = get<2>(quotes.load()) == 3;
+
+        quotes.store({4., 5., 6});
+
+        return ok && quotes.load() == luple_t<Quotes>{4., 5., 6};
+    }
+}
+
+namespace nuple_ns
+{
+    using Trade = nuple<$("sym"), std::string, $("qty"), long, $("px"), double>;
+
+    //C string keys are grouped by their characters, not by the pointers
+    bool testGroupCStrings()
+    {
+        using namespace agg;
+
+        char ibm1[] = "IBM", ibm2[] = "IBM", msft[] = "MSFT";
+        std::vector<nuple<$("sym"), char const*, $("qty"), int>> rows{{ibm1, 10}, {msft, 5}, {ibm2, 20}};
+
+        auto groups = group_by<$("sym")>(rows).agg(sum<$("qty")>);
+
+        return groups.size() == 2 && get<$("sum_qty")>(groups[0]) == 30 && get<$("sum_qty")>(groups[1]) == 5;
+    }
+
+    bool testGroup()
+    {
+        using namespace agg;
+
+        std::vector<Trade> rows{{"IBM", 10, 1.5}, {"MSFT", 5, 2.}, {"IBM", 20, 0.5}, {"IBM", 1, 3.}};
+
+        auto check = [](auto const& groups) {
+            bool ok = groups.size() == 2;
+            for (auto const& g : groups) {
+                bool ibm = get<$("sym")>(g) == "IBM";
+                ok = ok && get<$("sum_qty")>(g) == (ibm ? 31 : 5) && get<$("max_px")>(g) == (ibm ? 3. : 2.)
+                        && get<$("min_px")>(g) == (ibm ? 0.5 : 2.) && get<$("count")>(g) == (ibm ? 3u : 1u);
+            }
+            return ok;
+        };
+
+        return check(group_by<$("sym")>(rows).agg(sum<$("qty")>, max<$("px")>, min<$("px")>, count))
+            && check(group_by<$("sym")>(rows).parallel(2).agg(sum<$("qty")>, max<$("px")>, min<$("px")>, count))
+            && group_by<$("sym"), $("qty")>(rows).agg(count).size() == 4 && testGroupCStrings();
+    }
+}
+
+namespace nuple_ns
+{
+    using ServiceMetrics = metrics<nuple<$("requests"), std::uint64_t, $("errors"), std::uint64_t>>;
+
+    bool testMetrics()
+    {
+        ServiceMetrics::add<$("requests")>();
+        ServiceMetrics::local().add<$("errors")>(2);
+
+        std::thread other{[] { ServiceMetrics::add<$("requests")>(3); }};
+        other.join();
+
+        auto totals = ServiceMetrics::scrape();
+
+        std::string text;
+        ServiceMetrics::write_prometheus(text);
+
+        return get<$("requests")>(totals) == 4 && get<$("errors")>(totals) == 2
+            && text.find("requests 4") != std::string::npos && text.find("errors 2") != std::string::npos;
+    }
+}
+
+namespace nuple_ns
+{
+    using Execution = nuple<$("id"), int, $("qty"), int>;
+
+    bool testLog()
+    {
+        std::string text;
+        nuple_log::drain(text);
+        text.clear();
+
+        nuple_log::log(Execution{1, 100});
+        nuple_log::log($name("order {} filled"), 7);
+
+        nuple_log::drain(text);
+
+        return text.find("id=1") != std::string::npos && text.find("qty=100") != std::string::npos
+            && text.find("order 7 filled") != std::string::npos && nuple_log::dropped() == 0;
+    }
+}
+
+namespace luple_ns
+{
+    using Order = type_list<std::uint64_t, double, int>;
+
+    bool testQueue()
+    {
+        spsc_queue<Order> spsc{8};
+        mpmc_queue<Order, queue_soa> mpmc{8};
+
+        luple_t<Order> in[10], out[10];
+        for (int i = 0; i < 10; ++i) in[i] = luple_t<Order>{std::uint64_t(i), i * 0.5, -i};
+
+        bool ok = spsc.push_n(in, 10) == 8 && !spsc.push(in[9]) && spsc.pop_n(out, 10) == 8 && !spsc.pop(out[9]);
+        for (int i = 0; i < 8; ++i) ok = ok && out[i] == in[i];
+
+        std::uint64_t ids[3] = {1, 2, 3}, ids2[3];
+        double prices[3] = {1.5, 2.5, 3.5}, prices2[3];
+        int qtys[3] = {10, 20, 30}, qtys2[3];
+
+        ok = ok && mpmc.push_columns(3, ids, prices, qtys) == 3 && mpmc.size() == 3 && mpmc.pop_columns(3, ids2, prices2, qtys2) == 3;
+
+        return ok && ids2[2] == 3 && prices2[1] == 2.5 && qtys2[0] == 10;
+    }
+
+    bool testQueueThreads()
+    {
+        const int producers = 4, consumers = 4, items = 20000;
+
+        mpmc_queue<type_list<int>> queue{64};
+        std::vector<std::atomic<int>> seen(producers * items);
+        std::atomic<int> popped{0};
+        std::vector<std::thread> threads;
+
+        for (int t = 0; t < producers; ++t)
+            threads.emplace_back([&, t] {
+                luple<int> batch[5];
+                for (int i = 0; i < items;) {
+                    int n = std::min(5, items - i);
+                    for (int j = 0; j < n; ++j) batch[j] = luple<int>{t * items + i + j};
+                    i += int(queue.push_n(batch, n));
+                    std::this_thread::yield();
+                }
+            });
+
+        for (int t = 0; t < consumers; ++t)
+            threads.emplace_back([&] {
+                luple<int> batch[7];
+                while (popped.load() < producers * items) {
+                    int n = int(queue.pop_n(batch, 7));
+                    for (int j = 0; j < n; ++j) seen[get<0>(batch[j])]++;
+                    popped += n;
+                    if (!n) std::this_thread::yield();
+                }
+            });
+
+        for (auto& t : threads) t.join();
+
+        bool once = true;
+        for (auto& s : seen) once = once && s == 1;
+
+        return once && queue.size() == 0;
+    }
+
+    //assigning the value -1 blocks while 'hold' is set: a producer stalled in the middle of a push
+    std::atomic<bool> hold{false}, held{false};
+
+    struct Stalling
+    {
+        int value = 0;
+
+        Stalling() {}
+        Stalling(int v) : value(v) {}
+        Stalling(const Stalling& o) : value(o.value) {}
+        Stalling& operator=(const Stalling& o)
+        {
+            if (o.value == -1) {
+                held = true;
+                while (hold) std::this_thread::yield();
+            }
+            value = o.value;
+            return *this;
+        }
+    };
+
+    bool testQueueStalled()
+    {
+        mpmc_queue<type_list<Stalling>> queue{8};
+        luple<Stalling> out[4];
+
+        hold = true;
+        std::thread producer{[&] { queue.push(luple<Stalling>{-1}); }};
+        while (!held) std::this_thread::yield();
+
+        //the first slot is claimed but not written: pop returns at once, other pushes go on
+        bool ok = queue.pop_n(out, 4) == 0 && queue.push(luple<Stalling>{2}) && queue.pop_n(out, 4) == 0;
+
+        hold = false;
+        producer.join();
+
+        return ok && queue.pop_n(out, 4) == 2 && get<0>(out[0]).value == -1 && get<0>(out[1]).value == 2;
+    }
+}
+
+namespace nuple_ns
+{
+    //string keys match by their characters, also a std::string against a C string in another buffer
+    bool testJoinStrings()
+    {
+        char ibm[] = "IBM", msft[] = "MSFT", ibm2[] = "IBM";
+        std::vector<nuple<$("sym"), std::string, $("qty"), int>> left{{"IBM", 1}, {"MSFT", 2}, {"ORCL", 3}};
+        std::vector<nuple<$("sym"), char const*, $("px"), double>> right{{ibm, 1.5}, {msft, 2.5}, {ibm2, 3.5}};
+        std::vector<nuple<$("sym"), char const*, $("qty"), int>> left2{{"IBM", 1}, {"MSFT", 2}};
+
+        auto joined = hash_join<$("sym")>(left, right);
+        auto joined2 = hash_join<$("sym")>(left2, right, 2);
+
+        double sum = 0;
+        for (auto const& r : joined) sum += get<$("qty")>(r) * get<$("px")>(r);
+
+        return joined.size() == 3 && sum == 1.5 + 5. + 3.5 && joined2.size() == 3;
+    }
+
+    bool testJoin()
+    {
+        std::vector<Order> orders;
+        std::vector<Fill> fills;
+
+        //some orders have several fills, some none, some fills have no order
+        for (int i = 0; i < 3000; ++i) orders.push_back(Order{i * 3 % 3001, i * 0.5});
+        for (int i = 0; i < 10000; ++i) fills.push_back(Fill{i, int(i * 7919u % 4000), i * 0.25});
+
+        std::vector<std::pair<int, int>> expected;
+        for (auto const& o : orders)
+            for (auto const& f : fills)
+                if (get<$("order_id")>(o) == get<$("order_id")>(f)) expected.emplace_back(get<$("order_id")>(o), get<$("fill_id")>(f));
+        std::sort(expected.begin(), expected.end());
+
+        auto same = [&](auto const& rows) {
+            std::vector<std::pair<int, int>> pairs;
+            for (auto const& r : rows) pairs.emplace_back(get<$("order_id")>(r), get<$("fill_id")>(r));
+            std::sort(pairs.begin(), pairs.end());
+            return pairs == expected;
+        };
+
+        auto byOrder = [](auto const& a, auto const& b) { return get<$("order_id")>(a) < get<$("order_id")>(b); };
+        std::vector<Order> sortedOrders = orders;
+        std::vector<Fill> sortedFills = fills;
+        std::sort(sortedOrders.begin(), sortedOrders.end(), byOrder);
+        std::stable_sort(sortedFills.begin(), sortedFills.end(), byOrder);
+
+        auto joined = hash_join<$("order_id")>(orders, fills);
+
+        return !expected.empty() && same(joined) && same(hash_join<$("order_id")>(orders, fills, 2))
+            && same(merge_join<$("order_id")>(sortedOrders, sortedFills))
+            && get<$("right_px")>(joined[0]) == get<$("px")>(fills[get<$("fill_id")>(joined[0])]) && testJoinStrings();
+    }
+}
+
+namespace nuple_ns
+{
+    using Tick = nuple<$("ts"), std::int64_t, $("sym"), std::string, $("qty"), int, $("side"), luple_ns::Side, $("px"), double>;
+
+    bool testColumns()
+    {
+        char const* symbols[] = {"IBM", "MSFT", "AAPL"};
+        std::vector<Tick> rows;
+
+        //sorted timestamps (delta), runs of one side (rle), small quantities (frame of reference)
+        for (int i = 0; i < 3000; ++i)
+            rows.push_back(Tick{1000000 + i * 10 + i % 3, symbols[i * 7 % 3], i * 37 % 500 - 100,
+                                i / 700 % 2 ? luple_ns::Side::sell : luple_ns::Side::buy, i % 100 * 0.5});
+
+        column_store<Tick> store{rows};
+
+        bool ok = store.size() == rows.size();
+        for (std::size_t i = 0; i < rows.size(); ++i) ok = ok && store.row(i) == rows[i];
+
+        auto brute = [&](auto pred) {
+            std::vector<std::uint32_t> ids;
+            for (std::size_t i = 0; i < rows.size(); ++i) if (pred(rows[i])) ids.push_back(std::uint32_t(i));
+            return ids;
+        };
+
+        ok = ok && store.filter<$("qty")>(-20, 50) == brute([](Tick const& t) { return get<$("qty")>(t) >= -20 && get<$("qty")>(t) <= 50; })
+                && store.filter<$("ts")>(1010000, 1020000) == brute([](Tick const& t) { return get<$("ts")>(t) >= 1010000 && get<$("ts")>(t) <= 1020000; })
+                && store.filter<$("side")>(luple_ns::Side::sell, luple_ns::Side::sell) == brute([](Tick const& t) { return get<$("side")>(t) == luple_ns::Side::sell; })
+                && store.filter<$("px")>(10., 20.) == brute([](Tick const& t) { return get<$("px")>(t) >= 10. && get<$("px")>(t) <= 20.; })
+                && store.filter<$("sym")>([](std::string const& v) { return v != "MSFT"; }) == brute([](Tick const& t) { return get<$("sym")>(t) != "MSFT"; });
+
+        long sum = 0;
+        store.scan<$("qty")>([&](std::size_t, int q) { sum += q; });
+        for (auto const& t : rows) sum -= get<$("qty")>(t);
+
+        auto ts = store.stats<$("ts")>();
+        auto sym = store.stats<$("sym")>();
+
+        return ok && sum == 0 && ts.blocks[luple_ns::column_delta] > 0 && store.stats<$("side")>().blocks[luple_ns::column_rle] > 0
+                  && ts.ratio() > 4 && sym.dictionary == 3 && sym.ratio() > 10;
+    }
+}
+
 int main()
 {
-    return 0;
+    bool ok = luple_ns::testArena();
+    ok = luple_ns::testPaddedCat() && ok;
+    ok = luple_ns::testMath() && ok;
+    ok = nuple_ns::testIndex() && ok;
+    ok = nuple_ns::testCsv() && ok;
+    ok = luple_ns::testArchetype() && ok;
+    ok = nuple_ns::testMvcc() && ok;
+    ok = luple_ns::testSeqlock() && ok;
+    ok = nuple_ns::testGroup() && ok;
+    ok = nuple_ns::testMetrics() && ok;
+    ok = nuple_ns::testLog() && ok;
+    ok = luple_ns::testQueue() && ok;
+    ok = luple_ns::testQueueThreads() && ok;
+    ok = luple_ns::testQueueStalled() && ok;
+    ok = nuple_ns::testJoin() && ok;
+    ok = nuple_ns::testColumns() && ok;
+
+    return ok ? 0 : 1;
 }
+